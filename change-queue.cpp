@@ -0,0 +1,233 @@
+#include "pch.h"
+#include "change-queue.h"
+#include "macrowriter.h"
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+//
+// The queue shared by every scanning thread and the consumer
+// Never destroyed: the injected scanner is never joined, so the consumer may still be waiting on it while the process exits
+//
+
+typedef struct _CHANGE_QUEUE
+{
+	std::mutex Lock;
+	std::condition_variable Posted;
+	std::condition_variable Finished;
+	std::deque<CHANGE_EVENT> Events;
+	size_t Capacity = 0;
+	bool PromptNames = false;
+	std::string PatchDirectory;
+	bool Running = false;
+	bool Consuming = false;
+	size_t Refused = 0;
+	size_t Sequence = 0;
+} CHANGE_QUEUE;
+
+static CHANGE_QUEUE& ChangeQueue = *new CHANGE_QUEUE();
+
+/*++
+
+Routine Description:
+
+	Outputs a change event: the page, every range of changed bytes, then the macro and its undo under the event's name,
+	and writes its patch file into PatchDirectory unless that is empty
+
+Parameters:
+
+	Event - The change event
+	MacroName - The name of the macro
+	PatchDirectory - The directory patch files are written to, empty to write none
+
+Return Value:
+
+	None
+
+--*/
+static void OutputChangeEvent(const CHANGE_EVENT& Event, const std::string& MacroName, const std::string& PatchDirectory)
+{
+	static thread_local MACRO_WRITER Writer;
+
+	if (Event.ProcessId)
+	{
+		std::cout << "Process: " << std::dec << Event.ProcessId << " | ";
+	}
+	std::cout << "Page change: " << Event.BaseAddress << " | Changed Checksum: " << Event.ChangedChecksum <<
+		" | Expected Checksum: " << Event.ExpectedChecksum << "\n";
+
+	for (const DIFF_RANGE& Range : Event.Diff.Ranges)
+	{
+		const BYTE* Changed = DiffRangeBytes(Event.Diff, Range, DiffApply);
+		std::cout << std::hex << "Change Address: " << DiffRangeAddress(Event.Diff, Range, Event.ModuleBase) << " | Module Offset: 0x" <<
+			DiffRangeOffset(Event.Diff, Range) << " | Length: 0x" << Range.Length << " | Changed bytes: ";
+		for (SIZE_T Index = 0; Index < Range.Length; Index++)
+		{
+			std::cout << "0x" << +Changed[Index] << " ";
+		}
+		std::cout << "\n\n";
+	}
+
+	//
+	// Output the generated macro statement utilizing WriteProcessMemory and the inverse of it (undo), written in one pass
+	// into the thread's macro writer, which keeps its buffers from one change to the next
+	//
+
+	WritePairMacro(Writer, MacroName, Event.Diff);
+	OutputMacro(Writer, std::cout);
+
+	if (!PatchDirectory.empty())
+	{
+		std::string Path = PatchDirectory + "/" + MacroName + ".mdpatch";
+		DWORD StatusCode = WritePatch(Writer, Event.ModuleBase, Event.Diff);
+		if (StatusCode)
+		{
+			std::cerr << "The patch could not be generated: " << StatusCode << std::endl;
+		}
+		else if (OutputPatch(Writer, Path))
+		{
+			std::cout << "Patch: " << Path << std::endl;
+		}
+		else
+		{
+			std::cerr << "The patch could not be written to " << Path << std::endl;
+		}
+	}
+}
+
+// the generated name of a change event's macro, the sequence number keeps names unique
+static std::string GenerateMacroName(const CHANGE_EVENT& Event, size_t Sequence)
+{
+	std::string MacroName = Event.ProcessId ? "Process" + std::to_string(Event.ProcessId) : "";
+	return MacroName + "Change" + std::to_string(Sequence);
+}
+
+static void ConsumeChangeEvents()
+{
+	std::unique_lock<std::mutex> Guard(ChangeQueue.Lock);
+	for (;;)
+	{
+		ChangeQueue.Posted.wait(Guard, []() { return !ChangeQueue.Events.empty() || !ChangeQueue.Running; });
+		if (ChangeQueue.Events.empty())
+		{
+			ChangeQueue.Consuming = false;
+			ChangeQueue.Finished.notify_all();
+			return;
+		}
+
+		CHANGE_EVENT Event = std::move(ChangeQueue.Events.front());
+		ChangeQueue.Events.pop_front();
+		size_t Sequence = ++ChangeQueue.Sequence;
+		size_t Refused = ChangeQueue.Refused;
+		ChangeQueue.Refused = 0;
+		Guard.unlock();
+
+		if (Refused)
+		{
+			std::cout << std::dec << Refused << " change(s) deferred to a later sweep, the change queue was full" << std::endl;
+		}
+
+		std::string MacroName = GenerateMacroName(Event, Sequence);
+		if (ChangeQueue.PromptNames)
+		{
+			std::string Answer;
+			std::cout << "Macro name? (" << MacroName << ") : ";
+			std::getline(std::cin, Answer);
+			if (!Answer.empty())
+			{
+				MacroName = Answer;
+			}
+		}
+
+		OutputChangeEvent(Event, MacroName, ChangeQueue.PatchDirectory);
+		Guard.lock();
+	}
+}
+
+/*++
+
+Routine Description:
+
+	Starts the consumer thread of the change queue
+
+Parameters:
+
+	Capacity - The most events waiting in the queue
+	PromptNames - Prompts the console for the name of each macro, the generated name is used when none is entered
+	PatchDirectory - The directory the patch file of each change is written to, empty to write none
+
+Return Value:
+
+	None
+
+--*/
+void StartChangeConsumer(size_t Capacity, bool PromptNames, const std::string& PatchDirectory)
+{
+	std::lock_guard<std::mutex> Guard(ChangeQueue.Lock);
+	if (ChangeQueue.Running)
+	{
+		return;
+	}
+
+	ChangeQueue.Capacity = Capacity;
+	ChangeQueue.PromptNames = PromptNames;
+	ChangeQueue.PatchDirectory = PatchDirectory;
+	ChangeQueue.Running = true;
+	ChangeQueue.Consuming = true;
+	std::thread(ConsumeChangeEvents).detach();
+}
+
+/*++
+
+Routine Description:
+
+	Posts a change event to the change queue, never waits for the consumer
+	Without a running consumer the event is output on the calling thread
+
+Parameters:
+
+	Event - The change event, moved into the queue when posted
+
+Return Value:
+
+	bool - false when the queue is full and the event was not posted
+
+--*/
+bool PostChangeEvent(CHANGE_EVENT& Event)
+{
+	std::unique_lock<std::mutex> Guard(ChangeQueue.Lock);
+	if (!ChangeQueue.Running)
+	{
+		size_t Sequence = ++ChangeQueue.Sequence;
+		Guard.unlock();
+		OutputChangeEvent(Event, GenerateMacroName(Event, Sequence), "");
+		return true;
+	}
+
+	if (ChangeQueue.Events.size() >= ChangeQueue.Capacity)
+	{
+		ChangeQueue.Refused++;
+		return false;
+	}
+
+	ChangeQueue.Events.push_back(std::move(Event));
+	Guard.unlock();
+	ChangeQueue.Posted.notify_one();
+	return true;
+}
+
+// outputs the events still queued, then stops the consumer thread
+void StopChangeConsumer()
+{
+	std::unique_lock<std::mutex> Guard(ChangeQueue.Lock);
+	if (!ChangeQueue.Running)
+	{
+		return;
+	}
+
+	ChangeQueue.Running = false;
+	ChangeQueue.Posted.notify_one();
+	ChangeQueue.Finished.wait(Guard, []() { return !ChangeQueue.Consuming; });
+}
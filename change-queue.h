@@ -0,0 +1,55 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+#include <string>
+#include "platform.h"
+#include "diff-range.h"
+
+//
+// Change Queue
+// Detected changes are posted as events to a bounded queue and a consumer thread outputs them: the changes, then the macro
+// and its undo. Macro names are generated (Change<N>, or Process<pid>Change<N> out-of-process) unless the consumer is started
+// prompting for them, so only the consumer ever waits on the console and the scanning threads never block on I/O
+// A full queue refuses the event, the scanner then leaves the change out of its snapshot and reports it, merged with anything
+// further, on a later sweep
+// The changes are addressed relative to their module (see diff-range.h), ModuleBase is its base in the process they were detected in
+// Given a patch directory, the consumer also writes each change as a binary patch file, <directory>/<macro name>.mdpatch
+//
+
+#define CHANGE_QUEUE_CAPACITY 256
+
+typedef struct _CHANGE_EVENT
+{
+	DWORD ProcessId;
+	PVOID BaseAddress;
+	PVOID ModuleBase;
+	std::string ChangedChecksum;
+	std::string ExpectedChecksum;
+	DIFF_SET Diff;
+} CHANGE_EVENT;
+
+void StartChangeConsumer(size_t Capacity = CHANGE_QUEUE_CAPACITY, bool PromptNames = false, const std::string& PatchDirectory = "");
+bool PostChangeEvent(CHANGE_EVENT& Event);
+void StopChangeConsumer();
@@ -0,0 +1,223 @@
+#include "pch.h"
+#include <algorithm>
+#include "checksum-tree.h"
+#include "error-checking.h"
+
+static inline unsigned int TreeChecksum(const BYTE* Data, SIZE_T Size, SIZE_T Offset, SIZE_T Granularity)
+{
+	SIZE_T Length = (Size - Offset < Granularity) ? Size - Offset : Granularity;
+	return crc_crypt(const_cast<BYTE*>(Data + Offset), static_cast<crc_size>(Length));
+}
+
+static inline SIZE_T TreeNodes(SIZE_T Size, SIZE_T Granularity)
+{
+	return (Size + Granularity - 1) / Granularity;
+}
+
+/*++
+
+Routine Description:
+
+	Builds every level of the checksum tree of a region snapshot
+
+Parameters:
+
+	Tree - Receives the checksums
+	Data - The region snapshot
+	Size - The size of the region
+	CacheLines - Also keep the 64-byte cache line level (4x the memory of the block level)
+
+Return Value:
+
+	None
+
+--*/
+void BuildChecksumTree(CHECKSUM_TREE& Tree, const BYTE* Data, SIZE_T Size, bool CacheLines)
+{
+	Tree.PageSums.resize(TreeNodes(Size, TREE_PAGE_SIZE));
+	Tree.BlockSums.resize(TreeNodes(Size, TREE_BLOCK_SIZE));
+	Tree.LineSums.resize(CacheLines ? TreeNodes(Size, TREE_LINE_SIZE) : 0);
+
+	for (SIZE_T Node = 0; Node < Tree.PageSums.size(); Node++)
+	{
+		Tree.PageSums[Node] = TreeChecksum(Data, Size, Node * TREE_PAGE_SIZE, TREE_PAGE_SIZE);
+	}
+
+	for (SIZE_T Node = 0; Node < Tree.BlockSums.size(); Node++)
+	{
+		Tree.BlockSums[Node] = TreeChecksum(Data, Size, Node * TREE_BLOCK_SIZE, TREE_BLOCK_SIZE);
+	}
+
+	for (SIZE_T Node = 0; Node < Tree.LineSums.size(); Node++)
+	{
+		Tree.LineSums[Node] = TreeChecksum(Data, Size, Node * TREE_LINE_SIZE, TREE_LINE_SIZE);
+	}
+}
+
+static inline void AppendSpan(std::vector<CHECKSUM_TREE_SPAN>& Spans, SIZE_T Offset, SIZE_T Length)
+{
+	if (!Spans.empty() && Spans.back().Offset + Spans.back().Length == Offset)
+	{
+		Spans.back().Length += Length;
+		return;
+	}
+	Spans.push_back({ Offset, Length });
+}
+
+/*++
+
+Routine Description:
+
+	Descends the checksum tree against the part of the live region known to hold the changes: the pages of that range are checksummed,
+	the blocks of the dirty pages, then the lines of the dirty blocks (when kept). The dirty leaves are appended as ascending, merged spans
+	The range is what the caller already found mismatching (a sweep chunk, a written page), so the descent costs the size of that range
+	and of the dirty pages rather than the size of the region
+
+Parameters:
+
+	Tree - The checksum tree of the region snapshot
+	Live - The region resident in module memory
+	Size - The size of the region
+	Offset - The start of the range holding the changes, rounded down to a page
+	Length - The length of the range, SIZE_MAX for the rest of the region
+	Spans - Receives the dirty spans, empty if the tree finds no difference
+
+Return Value:
+
+	None
+
+--*/
+void FindDirtySpans(const CHECKSUM_TREE& Tree, const BYTE* Live, SIZE_T Size, SIZE_T Offset, SIZE_T Length, std::vector<CHECKSUM_TREE_SPAN>& Spans)
+{
+	const SIZE_T BlocksPerPage = TREE_PAGE_SIZE / TREE_BLOCK_SIZE;
+	const SIZE_T LinesPerBlock = TREE_BLOCK_SIZE / TREE_LINE_SIZE;
+
+	if (Offset >= Size)
+	{
+		return;
+	}
+
+	SIZE_T FirstPage = Offset / TREE_PAGE_SIZE;
+	SIZE_T LastPage = (std::min)(TreeNodes(Offset + (std::min)(Length, Size - Offset), TREE_PAGE_SIZE), Tree.PageSums.size());
+
+	for (SIZE_T Page = FirstPage; Page < LastPage; Page++)
+	{
+		if (TreeChecksum(Live, Size, Page * TREE_PAGE_SIZE, TREE_PAGE_SIZE) == Tree.PageSums[Page])
+		{
+			continue;
+		}
+
+		SIZE_T LastBlock = (std::min)((Page + 1) * BlocksPerPage, Tree.BlockSums.size());
+		for (SIZE_T Block = Page * BlocksPerPage; Block < LastBlock; Block++)
+		{
+			if (TreeChecksum(Live, Size, Block * TREE_BLOCK_SIZE, TREE_BLOCK_SIZE) == Tree.BlockSums[Block])
+			{
+				continue;
+			}
+
+			if (Tree.LineSums.empty())
+			{
+				AppendSpan(Spans, Block * TREE_BLOCK_SIZE, (std::min)(static_cast<SIZE_T>(TREE_BLOCK_SIZE), Size - Block * TREE_BLOCK_SIZE));
+				continue;
+			}
+
+			SIZE_T LastLine = (std::min)((Block + 1) * LinesPerBlock, Tree.LineSums.size());
+			for (SIZE_T Line = Block * LinesPerBlock; Line < LastLine; Line++)
+			{
+				if (TreeChecksum(Live, Size, Line * TREE_LINE_SIZE, TREE_LINE_SIZE) != Tree.LineSums[Line])
+				{
+					AppendSpan(Spans, Line * TREE_LINE_SIZE, (std::min)(static_cast<SIZE_T>(TREE_LINE_SIZE), Size - Line * TREE_LINE_SIZE));
+				}
+			}
+		}
+	}
+}
+
+/*++
+
+Routine Description:
+
+	Checks live pages against the page level of the tree only,
+	used to verify the pages the OS reports written without hashing (or reading) the whole region
+
+Parameters:
+
+	Tree - The checksum tree of the region snapshot
+	Live - The live bytes of [Offset, Offset + Length) of the region, e.g. a page read out of another process
+	Size - The size of the region
+	Offset - The offset of the live bytes in the region, a multiple of TREE_PAGE_SIZE
+	Length - The number of live bytes, a multiple of TREE_PAGE_SIZE unless the range ends the region
+
+Return Value:
+
+	bool - true if every page covering the range matches the snapshot, false on a mismatch or an unaligned Offset
+
+--*/
+bool RangeMatchesTree(const CHECKSUM_TREE& Tree, const BYTE* Live, SIZE_T Size, SIZE_T Offset, SIZE_T Length)
+{
+	if (Length == 0 || Offset >= Size)
+	{
+		return true;
+	}
+
+	if (Offset % TREE_PAGE_SIZE)
+	{
+		return false;
+	}
+
+	SIZE_T End = (std::min)(Offset + Length, Size);
+
+	for (SIZE_T Node = Offset / TREE_PAGE_SIZE; Node * TREE_PAGE_SIZE < End && Node < Tree.PageSums.size(); Node++)
+	{
+		SIZE_T NodeLength = (std::min)(static_cast<SIZE_T>(TREE_PAGE_SIZE), End - Node * TREE_PAGE_SIZE);
+		if (crc_crypt(const_cast<BYTE*>(Live + Node * TREE_PAGE_SIZE - Offset), static_cast<crc_size>(NodeLength)) != Tree.PageSums[Node])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/*++
+
+Routine Description:
+
+	Recomputes only the nodes of every level covering [Offset, Offset + Length), after the snapshot bytes there were updated
+
+Parameters:
+
+	Tree - The checksum tree of the region snapshot
+	Data - The updated region snapshot
+	Size - The size of the region
+	Offset - The start of the updated bytes
+	Length - The number of updated bytes
+
+Return Value:
+
+	None
+
+--*/
+void UpdateChecksumTree(CHECKSUM_TREE& Tree, const BYTE* Data, SIZE_T Size, SIZE_T Offset, SIZE_T Length)
+{
+	if (Length == 0 || Offset >= Size)
+	{
+		return;
+	}
+
+	SIZE_T Last = (std::min)(Offset + Length, Size) - 1;
+
+	for (SIZE_T Node = Offset / TREE_PAGE_SIZE; Node <= Last / TREE_PAGE_SIZE && Node < Tree.PageSums.size(); Node++)
+	{
+		Tree.PageSums[Node] = TreeChecksum(Data, Size, Node * TREE_PAGE_SIZE, TREE_PAGE_SIZE);
+	}
+
+	for (SIZE_T Node = Offset / TREE_BLOCK_SIZE; Node <= Last / TREE_BLOCK_SIZE && Node < Tree.BlockSums.size(); Node++)
+	{
+		Tree.BlockSums[Node] = TreeChecksum(Data, Size, Node * TREE_BLOCK_SIZE, TREE_BLOCK_SIZE);
+	}
+
+	for (SIZE_T Node = Offset / TREE_LINE_SIZE; Node <= Last / TREE_LINE_SIZE && Node < Tree.LineSums.size(); Node++)
+	{
+		Tree.LineSums[Node] = TreeChecksum(Data, Size, Node * TREE_LINE_SIZE, TREE_LINE_SIZE);
+	}
+}
@@ -0,0 +1,64 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+#include <vector>
+#include "platform.h"
+
+//
+// Granularities of the checksum tree levels
+//
+
+#define TREE_PAGE_SIZE 4096
+#define TREE_BLOCK_SIZE 256
+#define TREE_LINE_SIZE 64
+
+//
+// Checksum Tree
+// CRC32 checksums of a region's snapshot per 4 KiB page, per 256-byte block and optionally per 64-byte cache line
+// A region checksum mismatch is narrowed down by descending the levels against the live region, from the range the mismatch was found in,
+// so only the dirty leaves of the snapshot are read and byte compared
+//
+
+typedef struct _CHECKSUM_TREE
+{
+	std::vector<unsigned int> PageSums;
+	std::vector<unsigned int> BlockSums;
+	std::vector<unsigned int> LineSums;
+} CHECKSUM_TREE;
+
+//
+// A run of dirty leaves, relative to the start of the region
+//
+
+typedef struct _CHECKSUM_TREE_SPAN
+{
+	SIZE_T Offset;
+	SIZE_T Length;
+} CHECKSUM_TREE_SPAN;
+
+void BuildChecksumTree(CHECKSUM_TREE& Tree, const BYTE* Data, SIZE_T Size, bool CacheLines);
+void FindDirtySpans(const CHECKSUM_TREE& Tree, const BYTE* Live, SIZE_T Size, SIZE_T Offset, SIZE_T Length, std::vector<CHECKSUM_TREE_SPAN>& Spans);
+bool RangeMatchesTree(const CHECKSUM_TREE& Tree, const BYTE* Live, SIZE_T Size, SIZE_T Offset, SIZE_T Length);
+void UpdateChecksumTree(CHECKSUM_TREE& Tree, const BYTE* Data, SIZE_T Size, SIZE_T Offset, SIZE_T Length);
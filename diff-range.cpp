@@ -0,0 +1,84 @@
+#include "pch.h"
+#include "diff-range.h"
+#include <cstring>
+
+/*++
+
+Routine Description:
+
+	Builds a difference set from the ascending offsets of the differing bytes of a page
+	Offsets closer than GapThreshold bytes apart are merged into one range, the original and changed
+	bytes of each range are copied once into the shared payload
+
+Parameters:
+
+	Diff - Receives the ranges and payload, any previous contents are discarded
+	Module - The module the page is in
+	Offset - The offset of the page from the module base, the offsets are relative to the page
+	Original - The original bytes, e.g. the page snapshot
+	Current - The changed bytes, e.g. the page resident in module memory
+	Offsets - The ascending offsets of the differing bytes, as reported by FindDifferences
+	GapThreshold - The largest run of unchanged bytes bridged between two changes
+
+Return Value:
+
+	None
+
+--*/
+void CoalesceDifferences(DIFF_SET& Diff, MODULE_ID Module, SIZE_T Offset, const BYTE* Original, const BYTE* Current, const std::vector<size_t>& Offsets, SIZE_T GapThreshold)
+{
+	Diff.Module = Module;
+	Diff.Offset = Offset;
+	Diff.Ranges.clear();
+	Diff.Payload.clear();
+
+	//
+	// First pass: merge the offsets into ranges, so the payload can be sized once
+	//
+
+	SIZE_T PayloadSize = 0;
+	for (size_t Index = 0; Index < Offsets.size(); Index++)
+	{
+		if (!Diff.Ranges.empty())
+		{
+			DIFF_RANGE& Last = Diff.Ranges.back();
+			SIZE_T End = Last.Offset + Last.Length;
+			if (Offsets[Index] - End <= GapThreshold)
+			{
+				PayloadSize += Offsets[Index] + 1 - End;
+				Last.Length = Offsets[Index] + 1 - Last.Offset;
+				continue;
+			}
+		}
+
+		Diff.Ranges.push_back({ Offsets[Index], 1, 0, 0 });
+		PayloadSize += 1;
+	}
+
+	//
+	// Second pass: copy the original then the changed bytes of each range into the payload
+	//
+
+	Diff.Payload.resize(PayloadSize * 2);
+	SIZE_T PayloadOffset = 0;
+	for (DIFF_RANGE& Range : Diff.Ranges)
+	{
+		Range.OldBytes = PayloadOffset;
+		memcpy(Diff.Payload.data() + PayloadOffset, Original + Range.Offset, Range.Length);
+		PayloadOffset += Range.Length;
+
+		Range.NewBytes = PayloadOffset;
+		memcpy(Diff.Payload.data() + PayloadOffset, Current + Range.Offset, Range.Length);
+		PayloadOffset += Range.Length;
+	}
+}
+
+SIZE_T DiffChangedBytes(const DIFF_SET& Diff)
+{
+	SIZE_T Length = 0;
+	for (const DIFF_RANGE& Range : Diff.Ranges)
+	{
+		Length += Range.Length;
+	}
+	return Length;
+}
@@ -0,0 +1,94 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+#include <vector>
+#include "platform.h"
+#include "module-table.h"
+
+//
+// Bytes apart two changes may be and still be merged into one range, the unchanged bytes between them are carried in both payloads
+//
+
+#define DIFF_DEFAULT_GAP_THRESHOLD 8
+
+//
+// Difference Range
+// A run of contiguous changed bytes, relative to the base of its DIFF_SET
+// OldBytes and NewBytes are the offsets of the original and changed bytes (Length each) in the DIFF_SET payload
+//
+
+typedef struct _DIFF_RANGE
+{
+	SIZE_T Offset;
+	SIZE_T Length;
+	SIZE_T OldBytes;
+	SIZE_T NewBytes;
+} DIFF_RANGE;
+
+//
+// Difference Set
+// The changes of one page, as coalesced ranges whose byte contents share a single payload buffer
+// The page is Offset bytes from the base of Module (see module-table.h), so the set holds no virtual address and applies to any
+// instance of the module: a range is at ModuleBase + Offset + Range.Offset in a process the module is loaded at ModuleBase in
+//
+
+typedef struct _DIFF_SET
+{
+	MODULE_ID Module;
+	SIZE_T Offset;
+	std::vector<DIFF_RANGE> Ranges;
+	std::vector<BYTE> Payload;
+} DIFF_SET;
+
+//
+// Which side of a difference set to produce, the changed bytes (apply) or the original bytes (undo)
+//
+
+typedef enum _DIFF_DIRECTION
+{
+	DiffApply,
+	DiffUndo
+} DIFF_DIRECTION;
+
+void CoalesceDifferences(DIFF_SET& Diff, MODULE_ID Module, SIZE_T Offset, const BYTE* Original, const BYTE* Current, const std::vector<size_t>& Offsets, SIZE_T GapThreshold);
+
+inline const BYTE* DiffRangeBytes(const DIFF_SET& Diff, const DIFF_RANGE& Range, DIFF_DIRECTION Direction)
+{
+	return Diff.Payload.data() + (Direction == DiffApply ? Range.NewBytes : Range.OldBytes);
+}
+
+// the offset of a range from the base of the set's module
+inline SIZE_T DiffRangeOffset(const DIFF_SET& Diff, const DIFF_RANGE& Range)
+{
+	return Diff.Offset + Range.Offset;
+}
+
+// the address of a range in a process the set's module is loaded at ModuleBase in
+inline PVOID DiffRangeAddress(const DIFF_SET& Diff, const DIFF_RANGE& Range, PVOID ModuleBase)
+{
+	return static_cast<BYTE*>(ModuleBase) + Diff.Offset + Range.Offset;
+}
+
+SIZE_T DiffChangedBytes(const DIFF_SET& Diff);
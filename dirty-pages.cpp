@@ -0,0 +1,284 @@
+#include "pch.h"
+#include "dirty-pages.h"
+
+#if !defined(_WIN32)
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+//
+// Pages queried per pagemap pread / QueryWorkingSetEx call
+//
+
+#define DIRTY_BATCH_PAGES 8192
+
+#if !defined(_WIN32)
+
+//
+// Soft-dirty bit of a pagemap entry
+//
+
+#define PAGEMAP_SOFT_DIRTY (1ULL << 55)
+
+/*++
+
+Routine Description:
+
+	Checks that the kernel maintains soft-dirty bits (CONFIG_MEM_SOFT_DIRTY), without it clear_refs accepts "4"
+	and every pagemap entry reads clean, which would hide every change
+	A private page of this process is written after a reset and must read back dirty, the kernel is the same for every process
+
+Return Value:
+
+	DWORD - 0, ERROR_NOT_SUPPORTED or errno
+
+--*/
+static DWORD ProbeSoftDirty(SIZE_T PageSize)
+{
+	int Pagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+	int ClearRefs = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+	void* Probe = mmap(NULL, PageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	DWORD StatusCode = 0;
+	unsigned long long Entry = 0;
+	if (Pagemap < 0 || ClearRefs < 0 || Probe == MAP_FAILED)
+	{
+		StatusCode = errno;
+	}
+	else if (pwrite(ClearRefs, "4", 1, 0) != 1)
+	{
+		StatusCode = errno;
+	}
+	else
+	{
+		*static_cast<volatile BYTE*>(Probe) = 1;
+		if (pread(Pagemap, &Entry, sizeof(Entry), (reinterpret_cast<size_t>(Probe) / PageSize) * sizeof(Entry)) != sizeof(Entry))
+		{
+			StatusCode = errno;
+		}
+		else if (!(Entry & PAGEMAP_SOFT_DIRTY))
+		{
+			StatusCode = ERROR_NOT_SUPPORTED;
+		}
+	}
+
+	if (Probe != MAP_FAILED)
+	{
+		munmap(Probe, PageSize);
+	}
+	if (ClearRefs >= 0)
+	{
+		close(ClearRefs);
+	}
+	if (Pagemap >= 0)
+	{
+		close(Pagemap);
+	}
+	return StatusCode;
+}
+#endif
+
+/*++
+
+Routine Description:
+
+	Opens the dirty page tracker of a process, the dirty state starts out unknown so the caller should reset it
+	after its first full sweep
+
+Parameters:
+
+	Tracker - The tracker to open
+	ProcessId - The process to track, 0 for the current process
+
+Return Value:
+
+	DWORD - 0, ERROR_NOT_SUPPORTED when the OS cannot track dirty pages, or GetLastError() (errno on Linux)
+
+--*/
+DWORD OpenDirtyTracker(DIRTY_TRACKER& Tracker, DWORD ProcessId)
+{
+#if defined(_WIN32)
+	SYSTEM_INFO SystemInformation;
+	GetSystemInfo(&SystemInformation);
+	Tracker.PageSize = SystemInformation.dwPageSize;
+
+	Tracker.Process = ProcessId ? OpenProcess(PROCESS_QUERY_INFORMATION, FALSE, ProcessId) : GetCurrentProcess();
+	if (!Tracker.Process)
+	{
+		return GetLastError();
+	}
+	return 0;
+#else
+	Tracker.PageSize = sysconf(_SC_PAGESIZE);
+	Tracker.Pagemap = -1;
+	Tracker.ClearRefs = -1;
+
+	DWORD StatusCode = ProbeSoftDirty(Tracker.PageSize);
+	if (StatusCode)
+	{
+		return StatusCode;
+	}
+
+	char Path[64];
+	if (ProcessId)
+	{
+		snprintf(Path, sizeof(Path), "/proc/%u/pagemap", ProcessId);
+	}
+	else
+	{
+		snprintf(Path, sizeof(Path), "/proc/self/pagemap");
+	}
+	Tracker.Pagemap = open(Path, O_RDONLY | O_CLOEXEC);
+
+	if (ProcessId)
+	{
+		snprintf(Path, sizeof(Path), "/proc/%u/clear_refs", ProcessId);
+	}
+	else
+	{
+		snprintf(Path, sizeof(Path), "/proc/self/clear_refs");
+	}
+	Tracker.ClearRefs = open(Path, O_WRONLY | O_CLOEXEC);
+
+	if (Tracker.Pagemap < 0 || Tracker.ClearRefs < 0)
+	{
+		StatusCode = errno;
+		CloseDirtyTracker(Tracker);
+		return StatusCode;
+	}
+	return 0;
+#endif
+}
+
+/*++
+
+Routine Description:
+
+	Marks every page of the process clean, pages written from here on are reported by FindDirtyPages
+	On Linux this write protects the whole process, so its next write to each page takes a minor fault
+
+Return Value:
+
+	DWORD - 0 or errno
+
+--*/
+DWORD ResetDirtyPages(DIRTY_TRACKER& Tracker)
+{
+#if defined(_WIN32)
+	return 0;
+#else
+	if (pwrite(Tracker.ClearRefs, "4", 1, 0) != 1)
+	{
+		return errno;
+	}
+	return 0;
+#endif
+}
+
+/*++
+
+Routine Description:
+
+	Appends the offsets of the pages of a region written since the last reset, in large batches per call into the OS
+
+Parameters:
+
+	Tracker - The tracker of the process the region is in
+	BaseAddress - The page aligned base address of the region
+	RegionSize - The size of the region
+	Offsets - Receives the offsets of the dirty pages relative to BaseAddress, in ascending order, each Tracker.PageSize long
+
+Return Value:
+
+	DWORD - 0 or GetLastError() (errno on Linux)
+
+--*/
+DWORD FindDirtyPages(DIRTY_TRACKER& Tracker, PVOID BaseAddress, SIZE_T RegionSize, std::vector<SIZE_T>& Offsets)
+{
+	SIZE_T PageCount = (RegionSize + Tracker.PageSize - 1) / Tracker.PageSize;
+	SIZE_T FirstPage = reinterpret_cast<SIZE_T>(BaseAddress) / Tracker.PageSize;
+
+	for (SIZE_T Done = 0; Done < PageCount;)
+	{
+		SIZE_T Batch = (PageCount - Done < DIRTY_BATCH_PAGES) ? PageCount - Done : DIRTY_BATCH_PAGES;
+
+#if defined(_WIN32)
+		Tracker.Entries.resize(Batch);
+		for (SIZE_T Page = 0; Page < Batch; Page++)
+		{
+			Tracker.Entries[Page].VirtualAddress = reinterpret_cast<PVOID>((FirstPage + Done + Page) * Tracker.PageSize);
+		}
+
+		if (!K32QueryWorkingSetEx(Tracker.Process, Tracker.Entries.data(), static_cast<DWORD>(Batch * sizeof(Tracker.Entries[0]))))
+		{
+			return GetLastError();
+		}
+
+		for (SIZE_T Page = 0; Page < Batch; Page++)
+		{
+			//
+			// Unmodified image pages are shared with the section, a valid private page was copied on write
+			// Pages that are not resident carry no attributes and are reported dirty
+			//
+
+			const PSAPI_WORKING_SET_EX_BLOCK& Attributes = Tracker.Entries[Page].VirtualAttributes;
+			if (!(Attributes.Valid && Attributes.Shared))
+			{
+				Offsets.push_back((Done + Page) * Tracker.PageSize);
+			}
+		}
+#else
+		Tracker.Entries.resize(Batch);
+		ssize_t Read = pread(Tracker.Pagemap, Tracker.Entries.data(), Batch * sizeof(Tracker.Entries[0]), (FirstPage + Done) * sizeof(Tracker.Entries[0]));
+		if (Read < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return errno;
+		}
+
+		Batch = Read / sizeof(Tracker.Entries[0]);
+		if (Batch == 0)
+		{
+			return ERROR_INVALID_PARAMETER;
+		}
+
+		for (SIZE_T Page = 0; Page < Batch; Page++)
+		{
+			if (Tracker.Entries[Page] & PAGEMAP_SOFT_DIRTY)
+			{
+				Offsets.push_back((Done + Page) * Tracker.PageSize);
+			}
+		}
+#endif
+
+		Done += Batch;
+	}
+	return 0;
+}
+
+void CloseDirtyTracker(DIRTY_TRACKER& Tracker)
+{
+#if defined(_WIN32)
+	if (Tracker.Process && Tracker.Process != GetCurrentProcess())
+	{
+		CloseHandle(Tracker.Process);
+	}
+	Tracker.Process = NULL;
+#else
+	if (Tracker.Pagemap >= 0)
+	{
+		close(Tracker.Pagemap);
+	}
+	if (Tracker.ClearRefs >= 0)
+	{
+		close(Tracker.ClearRefs);
+	}
+	Tracker.Pagemap = -1;
+	Tracker.ClearRefs = -1;
+#endif
+}
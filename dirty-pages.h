@@ -0,0 +1,58 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#pragma once
+#include <vector>
+#include "platform.h"
+
+#if defined(_WIN32)
+#include <psapi.h>
+#endif
+
+//
+// Dirty Page Tracker
+// Asks the OS which pages were written since the last reset, so a sweep only has to hash those pages
+// Linux: soft-dirty bits, cleared through /proc/<pid>/clear_refs and read back from /proc/<pid>/pagemap (bit 55)
+// Windows: the working set Shared bit, an image page that was written was copied on write and is no longer shared (reset is a no-op)
+// Neither catches every write (a write racing the reset, DMA), so the scanner keeps a periodic full checksum sweep
+//
+
+typedef struct _DIRTY_TRACKER
+{
+#if defined(_WIN32)
+	HANDLE Process;
+	std::vector<PSAPI_WORKING_SET_EX_INFORMATION> Entries;
+#else
+	int Pagemap;
+	int ClearRefs;
+	std::vector<unsigned long long> Entries;
+#endif
+	SIZE_T PageSize;
+} DIRTY_TRACKER;
+
+DWORD OpenDirtyTracker(DIRTY_TRACKER& Tracker, DWORD ProcessId);
+DWORD ResetDirtyPages(DIRTY_TRACKER& Tracker);
+DWORD FindDirtyPages(DIRTY_TRACKER& Tracker, PVOID BaseAddress, SIZE_T RegionSize, std::vector<SIZE_T>& Offsets);
+void CloseDirtyTracker(DIRTY_TRACKER& Tracker);
@@ -1,5 +1,8 @@
 #include "pch.h"
 #include "error-checking.h"
+#include <cstring>
+#include <mutex>
+#include "platform.h"
 
 // Table from Github: https://github.com/Zer0Mem0ry/CRC32
 unsigned int uiCRC32_Table[256] =
@@ -91,18 +94,549 @@ unsigned int uiCRC32_Table[256] =
 	0xB40BBE37L, 0xC30C8EA1L, 0x5A05DF1BL,
 	0x2D02EF8DL };
 
-// crc hash algorithm from Github: https://github.com/Zer0Mem0ry/CRC32
-unsigned int crc_crypt(crc_buffer pData, crc_size iLen)
+//
+// Slicing tables, uiCRC32_Slice[0] is uiCRC32_Table and uiCRC32_Slice[n] advances uiCRC32_Slice[n - 1] by one more zero byte
+// CRC32C byte table, and the operators that shift a CRC32C over CRC32C_LONG/CRC32C_SHORT zero bytes (combining interleaved streams)
+// Generated once, with the processor features, by crc_generate_tables: through crc_initialize, or by the first crc32c_crypt
+// std::call_once makes that safe when several threads get there first, and publishes crc32c_routine to all of them
+//
+
+#define CRC32C_POLYNOMIAL 0x82F63B78
+#define CRC32C_LONG 8192
+#define CRC32C_SHORT 256
+
+static unsigned int uiCRC32_Slice[16][256];
+static unsigned int uiCRC32C_Table[256];
+static unsigned int uiCRC32C_Long[4][256];
+static unsigned int uiCRC32C_Short[4][256];
+
+static unsigned int (*crc_routine)(crc_buffer pData, crc_size iLen) = crc_crypt_bytewise;
+static unsigned int (*crc32c_routine)(crc_buffer pData, crc_size iLen) = NULL;
+crc_engine crc_active_engine = crc_engine_bytewise;
+crc_polynomial crc_active_polynomial = crc_polynomial_ieee;
+bool crc_hardware_crc32c = false;
+static bool crc_hardware_pclmul = false;
+static std::once_flag crc_tables_generated;
+
+static inline unsigned int crc_load32(const unsigned char* pszData)
+{
+	unsigned int uiWord;
+	memcpy(&uiWord, pszData, sizeof(uiWord));
+	return uiWord;
+}
+
+//
+// GF(2) matrix helpers used to build the CRC32C zero-shift operators
+// The matrices are 32 columns of the reflected polynomial state
+//
+
+static unsigned int crc_gf2_times(const unsigned int* mat, unsigned int vec)
+{
+	unsigned int sum = 0;
+	while (vec)
+	{
+		if (vec & 1)
+		{
+			sum ^= *mat;
+		}
+		vec >>= 1;
+		mat++;
+	}
+	return sum;
+}
+
+static void crc_gf2_square(unsigned int* square, const unsigned int* mat)
+{
+	for (size_t n = 0; n < 32; n++)
+	{
+		square[n] = crc_gf2_times(mat, mat[n]);
+	}
+}
+
+static void crc32c_zeros(unsigned int zeros[4][256], size_t len)
 {
-	unsigned int uiCRC32 = 0xFFFFFFFF;
-	unsigned char* pszData = (unsigned char*)pData;
+	unsigned int even[32];
+	unsigned int odd[32];
+
+	//
+	// odd is the operator for one zero bit, squaring it twice gives the operator for one zero byte (in odd)
+	// Keep squaring, alternating between the two buffers, until len (a power of two) is consumed
+	//
+
+	odd[0] = CRC32C_POLYNOMIAL;
+	unsigned int row = 1;
+	for (size_t n = 1; n < 32; n++)
+	{
+		odd[n] = row;
+		row <<= 1;
+	}
 
+	crc_gf2_square(even, odd);
+	crc_gf2_square(odd, even);
+
+	unsigned int* op = odd;
+	do
+	{
+		crc_gf2_square(even, odd);
+		op = even;
+		len >>= 1;
+		if (len == 0)
+		{
+			break;
+		}
+		crc_gf2_square(odd, even);
+		op = odd;
+		len >>= 1;
+	} while (len);
+
+	for (unsigned int n = 0; n < 256; n++)
+	{
+		zeros[0][n] = crc_gf2_times(op, n);
+		zeros[1][n] = crc_gf2_times(op, n << 8);
+		zeros[2][n] = crc_gf2_times(op, n << 16);
+		zeros[3][n] = crc_gf2_times(op, n << 24);
+	}
+}
+
+static inline unsigned int crc32c_shift(unsigned int zeros[4][256], unsigned int crc)
+{
+	return zeros[0][crc & 0xFF] ^ zeros[1][(crc >> 8) & 0xFF] ^ zeros[2][(crc >> 16) & 0xFF] ^ zeros[3][crc >> 24];
+}
+
+//
+// Table based engines, these operate on the raw (not inverted) CRC state so the hardware engines can finish their tails with them
+//
+
+static unsigned int crc_update_bytewise(unsigned int uiCRC32, const unsigned char* pszData, size_t iLen)
+{
 	for (size_t i = 0; i < iLen; ++i)
 	{
 		uiCRC32 = ((uiCRC32 >> 8) & 0x00FFFFFF) ^ uiCRC32_Table[(uiCRC32 ^ (unsigned int)*pszData++) & 0xFF];
 	}
+	return uiCRC32;
+}
+
+//
+// Slicing-by-8, folds 8 bytes per iteration through 8 independent table lookups (little-endian loads)
+//
+
+static unsigned int crc_update_slice8(unsigned int uiCRC32, const unsigned char* pszData, size_t iLen)
+{
+	for (; iLen >= 8; iLen -= 8, pszData += 8)
+	{
+		unsigned int uiLow = crc_load32(pszData) ^ uiCRC32;
+		unsigned int uiHigh = crc_load32(pszData + 4);
+
+		uiCRC32 = uiCRC32_Slice[7][uiLow & 0xFF] ^ uiCRC32_Slice[6][(uiLow >> 8) & 0xFF] ^
+			uiCRC32_Slice[5][(uiLow >> 16) & 0xFF] ^ uiCRC32_Slice[4][uiLow >> 24] ^
+			uiCRC32_Slice[3][uiHigh & 0xFF] ^ uiCRC32_Slice[2][(uiHigh >> 8) & 0xFF] ^
+			uiCRC32_Slice[1][(uiHigh >> 16) & 0xFF] ^ uiCRC32_Slice[0][uiHigh >> 24];
+	}
+
+	return crc_update_bytewise(uiCRC32, pszData, iLen);
+}
+
+//
+// Slicing-by-16, same as slicing-by-8 over four words per iteration
+// Uses 16 KiB of tables, so it only pays off when the tables stay resident in L1/L2 across a sweep
+//
+
+static unsigned int crc_update_slice16(unsigned int uiCRC32, const unsigned char* pszData, size_t iLen)
+{
+	for (; iLen >= 16; iLen -= 16, pszData += 16)
+	{
+		unsigned int uiWord0 = crc_load32(pszData) ^ uiCRC32;
+		unsigned int uiWord1 = crc_load32(pszData + 4);
+		unsigned int uiWord2 = crc_load32(pszData + 8);
+		unsigned int uiWord3 = crc_load32(pszData + 12);
+
+		uiCRC32 = uiCRC32_Slice[15][uiWord0 & 0xFF] ^ uiCRC32_Slice[14][(uiWord0 >> 8) & 0xFF] ^
+			uiCRC32_Slice[13][(uiWord0 >> 16) & 0xFF] ^ uiCRC32_Slice[12][uiWord0 >> 24] ^
+			uiCRC32_Slice[11][uiWord1 & 0xFF] ^ uiCRC32_Slice[10][(uiWord1 >> 8) & 0xFF] ^
+			uiCRC32_Slice[9][(uiWord1 >> 16) & 0xFF] ^ uiCRC32_Slice[8][uiWord1 >> 24] ^
+			uiCRC32_Slice[7][uiWord2 & 0xFF] ^ uiCRC32_Slice[6][(uiWord2 >> 8) & 0xFF] ^
+			uiCRC32_Slice[5][(uiWord2 >> 16) & 0xFF] ^ uiCRC32_Slice[4][uiWord2 >> 24] ^
+			uiCRC32_Slice[3][uiWord3 & 0xFF] ^ uiCRC32_Slice[2][(uiWord3 >> 8) & 0xFF] ^
+			uiCRC32_Slice[1][(uiWord3 >> 16) & 0xFF] ^ uiCRC32_Slice[0][uiWord3 >> 24];
+	}
+
+	return crc_update_bytewise(uiCRC32, pszData, iLen);
+}
+
+static unsigned int crc32c_update_bytewise(unsigned int uiCRC32, const unsigned char* pszData, size_t iLen)
+{
+	for (size_t i = 0; i < iLen; ++i)
+	{
+		uiCRC32 = (uiCRC32 >> 8) ^ uiCRC32C_Table[(uiCRC32 ^ (unsigned int)*pszData++) & 0xFF];
+	}
+	return uiCRC32;
+}
+
+static unsigned int crc32c_crypt_bytewise(crc_buffer pData, crc_size iLen)
+{
+	return crc32c_update_bytewise(0xFFFFFFFF, (const unsigned char*)pData, iLen) ^ 0xFFFFFFFF;
+}
+
+#if defined(PLATFORM_X86)
+
+//
+// PCLMULQDQ folding for the ieee polynomial (Intel, "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ")
+// Four 128-bit lanes are folded forward by 64 bytes per iteration, then folded into one lane, reduced to 64 bits,
+// and Barrett reduced to the 32-bit CRC. Requires at least 64 bytes, the remainder (< 16 bytes) is finished with slicing-by-16
+//
+
+PLATFORM_TARGET("sse4.1,pclmul")
+static unsigned int crc_update_pclmul(unsigned int uiCRC32, const unsigned char* pszData, size_t iLen)
+{
+	alignas(16) static const unsigned long long k1k2[] = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+	alignas(16) static const unsigned long long k3k4[] = { 0x01751997d0ULL, 0x00ccaa009eULL };
+	alignas(16) static const unsigned long long k5k0[] = { 0x0163cd6124ULL, 0x0000000000ULL };
+	alignas(16) static const unsigned long long poly[] = { 0x01db710641ULL, 0x01f7011641ULL };
+
+	if (iLen < 64)
+	{
+		return crc_update_slice16(uiCRC32, pszData, iLen);
+	}
+
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+	x1 = _mm_loadu_si128((const __m128i*)(pszData + 0x00));
+	x2 = _mm_loadu_si128((const __m128i*)(pszData + 0x10));
+	x3 = _mm_loadu_si128((const __m128i*)(pszData + 0x20));
+	x4 = _mm_loadu_si128((const __m128i*)(pszData + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)uiCRC32));
+	x0 = _mm_load_si128((const __m128i*)k1k2);
+
+	pszData += 64;
+	iLen -= 64;
+
+	//
+	// Fold 64 bytes per iteration
+	//
+
+	while (iLen >= 64)
+	{
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(pszData + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(pszData + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(pszData + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(pszData + 0x30)));
+
+		pszData += 64;
+		iLen -= 64;
+	}
+
+	//
+	// Fold the four lanes into one
+	//
+
+	x0 = _mm_load_si128((const __m128i*)k3k4);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	//
+	// Fold the remaining 16 byte blocks
+	//
+
+	while (iLen >= 16)
+	{
+		x2 = _mm_loadu_si128((const __m128i*)pszData);
+
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+		pszData += 16;
+		iLen -= 16;
+	}
+
+	//
+	// Reduce 128 bits to 64 bits
+	//
+
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+
+	x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
 
-	return (uiCRC32 ^ 0xFFFFFFFF);
+	//
+	// Barrett reduction to 32 bits
+	//
+
+	x0 = _mm_load_si128((const __m128i*)poly);
+
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return crc_update_slice16((unsigned int)_mm_extract_epi32(x1, 1), pszData, iLen);
+}
+
+//
+// SSE4.2 crc32 instruction, one instruction has a 3 cycle latency but a throughput of one per cycle,
+// so three independent streams are hashed at once and combined with the zero-shift operators
+//
+
+#if defined(_M_X64) || defined(__x86_64__)
+typedef unsigned long long crc32c_word;
+#define crc32c_step(crc, pszData) (unsigned int)_mm_crc32_u64((crc), *(const unsigned long long*)(pszData))
+#else
+typedef unsigned int crc32c_word;
+#define crc32c_step(crc, pszData) _mm_crc32_u32((crc), *(const unsigned int*)(pszData))
+#endif
+
+PLATFORM_TARGET("sse4.2")
+static unsigned int crc32c_update_sse42(unsigned int uiCRC32, const unsigned char* pszData, size_t iLen)
+{
+	unsigned int crc0 = uiCRC32;
+
+	//
+	// Align to the word size so the streams use aligned loads
+	//
+
+	while (iLen && ((size_t)pszData & (sizeof(crc32c_word) - 1)) != 0)
+	{
+		crc0 = _mm_crc32_u8(crc0, *pszData++);
+		iLen--;
+	}
+
+	while (iLen >= CRC32C_LONG * 3)
+	{
+		unsigned int crc1 = 0;
+		unsigned int crc2 = 0;
+		const unsigned char* pszEnd = pszData + CRC32C_LONG;
+		do
+		{
+			crc0 = crc32c_step(crc0, pszData);
+			crc1 = crc32c_step(crc1, pszData + CRC32C_LONG);
+			crc2 = crc32c_step(crc2, pszData + CRC32C_LONG * 2);
+			pszData += sizeof(crc32c_word);
+		} while (pszData < pszEnd);
+		crc0 = crc32c_shift(uiCRC32C_Long, crc0) ^ crc1;
+		crc0 = crc32c_shift(uiCRC32C_Long, crc0) ^ crc2;
+		pszData += CRC32C_LONG * 2;
+		iLen -= CRC32C_LONG * 3;
+	}
+
+	while (iLen >= CRC32C_SHORT * 3)
+	{
+		unsigned int crc1 = 0;
+		unsigned int crc2 = 0;
+		const unsigned char* pszEnd = pszData + CRC32C_SHORT;
+		do
+		{
+			crc0 = crc32c_step(crc0, pszData);
+			crc1 = crc32c_step(crc1, pszData + CRC32C_SHORT);
+			crc2 = crc32c_step(crc2, pszData + CRC32C_SHORT * 2);
+			pszData += sizeof(crc32c_word);
+		} while (pszData < pszEnd);
+		crc0 = crc32c_shift(uiCRC32C_Short, crc0) ^ crc1;
+		crc0 = crc32c_shift(uiCRC32C_Short, crc0) ^ crc2;
+		pszData += CRC32C_SHORT * 2;
+		iLen -= CRC32C_SHORT * 3;
+	}
+
+	for (; iLen >= sizeof(crc32c_word); iLen -= sizeof(crc32c_word), pszData += sizeof(crc32c_word))
+	{
+		crc0 = crc32c_step(crc0, pszData);
+	}
+
+	while (iLen)
+	{
+		crc0 = _mm_crc32_u8(crc0, *pszData++);
+		iLen--;
+	}
+
+	return crc0;
+}
+
+unsigned int crc32c_crypt_sse42(crc_buffer pData, crc_size iLen)
+{
+	return crc32c_update_sse42(0xFFFFFFFF, (const unsigned char*)pData, iLen) ^ 0xFFFFFFFF;
+}
+
+#else
+
+unsigned int crc32c_crypt_sse42(crc_buffer pData, crc_size iLen)
+{
+	return crc32c_crypt(pData, iLen);
+}
+
+#endif
+
+static void crc_generate_tables()
+{
+	for (size_t i = 0; i < 256; ++i)
+	{
+		uiCRC32_Slice[0][i] = uiCRC32_Table[i];
+
+		unsigned int uiEntry = (unsigned int)i;
+		for (size_t Bit = 0; Bit < 8; ++Bit)
+		{
+			uiEntry = (uiEntry & 1) ? (uiEntry >> 1) ^ CRC32C_POLYNOMIAL : uiEntry >> 1;
+		}
+		uiCRC32C_Table[i] = uiEntry;
+	}
+
+	for (size_t Slice = 1; Slice < 16; ++Slice)
+	{
+		for (size_t i = 0; i < 256; ++i)
+		{
+			unsigned int uiPrevious = uiCRC32_Slice[Slice - 1][i];
+			uiCRC32_Slice[Slice][i] = (uiPrevious >> 8) ^ uiCRC32_Table[uiPrevious & 0xFF];
+		}
+	}
+
+	crc32c_zeros(uiCRC32C_Long, CRC32C_LONG);
+	crc32c_zeros(uiCRC32C_Short, CRC32C_SHORT);
+
+	//
+	// CPUID leaf 1, ECX bit 1 is PCLMULQDQ, bit 19 is SSE4.1, bit 20 is SSE4.2
+	//
+
+	crc_hardware_pclmul = false;
+	crc_hardware_crc32c = false;
+	crc32c_routine = crc32c_crypt_bytewise;
+
+#if defined(PLATFORM_X86)
+	int CpuInfo[4] = { 0 };
+	PlatformCpuid(CpuInfo, 1);
+	crc_hardware_pclmul = (CpuInfo[2] & (1 << 1)) && (CpuInfo[2] & (1 << 19));
+	if (CpuInfo[2] & (1 << 20))
+	{
+		crc_hardware_crc32c = true;
+		crc32c_routine = crc32c_crypt_sse42;
+	}
+#endif
+}
+
+void crc_initialize(crc_engine engine)
+{
+	std::call_once(crc_tables_generated, crc_generate_tables);
+	bool bPclmul = crc_hardware_pclmul;
+
+	//
+	// Only an automatic pick may prefer castagnoli: pclmul keeps the legacy ieee values, and without it the crc32
+	// instruction outruns slice16. An engine the caller named is an ieee engine, so ieee is preferred with it
+	//
+
+	crc_polynomial polynomial = crc_polynomial_ieee;
+	if (engine == crc_engine_automatic)
+	{
+		engine = bPclmul ? crc_engine_pclmul : crc_engine_slice16;
+		if (!bPclmul && crc_hardware_crc32c)
+		{
+			polynomial = crc_polynomial_castagnoli;
+		}
+	}
+
+	if (engine == crc_engine_pclmul && !bPclmul)
+	{
+		engine = crc_engine_slice16;
+	}
+
+	switch (engine)
+	{
+	case crc_engine_slice8:
+		crc_routine = crc_crypt_slice8;
+		break;
+	case crc_engine_slice16:
+		crc_routine = crc_crypt_slice16;
+		break;
+	case crc_engine_pclmul:
+		crc_routine = crc_crypt_pclmul;
+		break;
+	default:
+		engine = crc_engine_bytewise;
+		crc_routine = crc_crypt_bytewise;
+		break;
+	}
+
+	crc_active_engine = engine;
+	crc_active_polynomial = polynomial;
+}
+
+crc_engine crc_selected_engine()
+{
+	return crc_active_engine;
+}
+
+crc_polynomial crc_preferred_polynomial()
+{
+	return crc_active_polynomial;
+}
+
+// crc hash algorithm from Github: https://github.com/Zer0Mem0ry/CRC32
+unsigned int crc_crypt(crc_buffer pData, crc_size iLen)
+{
+	return crc_routine(pData, iLen);
+}
+
+unsigned int crc32c_crypt(crc_buffer pData, crc_size iLen)
+{
+	std::call_once(crc_tables_generated, crc_generate_tables);
+	return crc32c_routine(pData, iLen);
+}
+
+unsigned int crc_crypt_polynomial(crc_polynomial polynomial, crc_buffer pData, crc_size iLen)
+{
+	if (polynomial == crc_polynomial_castagnoli)
+	{
+		return crc32c_crypt(pData, iLen);
+	}
+	return crc_crypt(pData, iLen);
+}
+
+unsigned int crc_crypt_bytewise(crc_buffer pData, crc_size iLen)
+{
+	return crc_update_bytewise(0xFFFFFFFF, (const unsigned char*)pData, iLen) ^ 0xFFFFFFFF;
+}
+
+unsigned int crc_crypt_slice8(crc_buffer pData, crc_size iLen)
+{
+	return crc_update_slice8(0xFFFFFFFF, (const unsigned char*)pData, iLen) ^ 0xFFFFFFFF;
+}
+
+unsigned int crc_crypt_slice16(crc_buffer pData, crc_size iLen)
+{
+	return crc_update_slice16(0xFFFFFFFF, (const unsigned char*)pData, iLen) ^ 0xFFFFFFFF;
+}
+
+unsigned int crc_crypt_pclmul(crc_buffer pData, crc_size iLen)
+{
+#if defined(PLATFORM_X86)
+	return crc_update_pclmul(0xFFFFFFFF, (const unsigned char*)pData, iLen) ^ 0xFFFFFFFF;
+#else
+	return crc_crypt_slice16(pData, iLen);
+#endif
 }
 
 crc_buffer crc_allocate(crc_size size)
@@ -6,8 +6,88 @@ typedef unsigned long crc_hash;
 typedef unsigned long crc_size;
 typedef void* crc_buffer;
 
+//
+// Polynomials a recorded checksum can be produced with
+// ieee - the reflected 0xEDB88320 polynomial of uiCRC32_Table, what crc_crypt has always produced
+// castagnoli - the reflected 0x82F63B78 (CRC32C) polynomial implemented by the SSE4.2 crc32 instruction
+// Checksums of different polynomials are never comparable, so every recorded checksum keeps its polynomial alongside it
+//
+
+typedef enum _crc_polynomial
+{
+	crc_polynomial_ieee,
+	crc_polynomial_castagnoli
+} crc_polynomial;
+
+//
+// crc_crypt engines, all of them produce bit-identical checksums
+// bytewise - one table lookup per byte, the original implementation
+// slice8/slice16 - slicing-by-8/16, 8 or 16 bytes per iteration using tables generated by crc_initialize
+// pclmul - PCLMULQDQ carry-less multiplication folding 64 bytes per iteration, requires PCLMULQDQ and SSE4.1
+// automatic - pclmul when the processor supports it, otherwise slice16 (see crc_preferred_polynomial)
+//
+
+typedef enum _crc_engine
+{
+	crc_engine_bytewise,
+	crc_engine_slice8,
+	crc_engine_slice16,
+	crc_engine_pclmul,
+	crc_engine_automatic
+} crc_engine;
+
 crc_buffer crc_allocate(crc_size size);
 void crc_deallocate(crc_buffer buffer);
 
+// generates the tables, queries CPUID and selects the engines used by crc_crypt and crc32c_crypt, called once at startup before any scanning thread runs
+void crc_initialize(crc_engine engine = crc_engine_automatic);
+crc_engine crc_selected_engine();
+
+// the polynomial new checksums are recorded with: castagnoli when crc_initialize picked the engine (automatic) and the processor
+// has the crc32 instruction but not pclmul, otherwise ieee; pclmul is preferred to keep legacy values, and a named engine is an ieee engine
+crc_polynomial crc_preferred_polynomial();
+
 // crc hash algorithm from Github: https://github.com/Zer0Mem0ry/CRC32
 unsigned int crc_crypt(crc_buffer pData, crc_size iLen);
+
+// CRC32C, the SSE4.2 crc32 instruction over three interleaved streams when supported, otherwise a table lookup per byte
+// Safe to call from any thread before crc_initialize, the first call generates the tables
+unsigned int crc32c_crypt(crc_buffer pData, crc_size iLen);
+
+unsigned int crc_crypt_polynomial(crc_polynomial polynomial, crc_buffer pData, crc_size iLen);
+
+unsigned int crc_crypt_bytewise(crc_buffer pData, crc_size iLen);
+unsigned int crc_crypt_slice8(crc_buffer pData, crc_size iLen);
+unsigned int crc_crypt_slice16(crc_buffer pData, crc_size iLen);
+unsigned int crc_crypt_pclmul(crc_buffer pData, crc_size iLen);
+
+// the SSE4.2 CRC32C engine, only valid where the processor has it (crc_hardware_crc32c)
+unsigned int crc32c_crypt_sse42(crc_buffer pData, crc_size iLen);
+
+// the engine and preferred polynomial crc_initialize selected, and whether the processor has the crc32 instruction (set by
+// crc_initialize or the first crc32c_crypt), read directly by crc_crypt_direct
+extern crc_engine crc_active_engine;
+extern crc_polynomial crc_active_polynomial;
+extern bool crc_hardware_crc32c;
+
+// crc_crypt_polynomial without the function pointer: a switch on the selected engine and a direct call to it,
+// for hot callers (Crc32Policy) that are inlined into the scan loop
+inline unsigned int crc_crypt_direct(crc_polynomial polynomial, crc_buffer pData, crc_size iLen)
+{
+	if (polynomial == crc_polynomial_castagnoli)
+	{
+		return crc_hardware_crc32c ? crc32c_crypt_sse42(pData, iLen) : crc32c_crypt(pData, iLen);
+	}
+
+	switch (crc_active_engine)
+	{
+	case crc_engine_pclmul:
+		return crc_crypt_pclmul(pData, iLen);
+	case crc_engine_slice16:
+		return crc_crypt_slice16(pData, iLen);
+	case crc_engine_slice8:
+		return crc_crypt_slice8(pData, iLen);
+	default:
+		return crc_crypt_bytewise(pData, iLen);
+	}
+}
@@ -0,0 +1,215 @@
+#include "pch.h"
+#include "governor.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+/*++
+
+Routine Description:
+
+	Starts a governor for a sweep loop
+
+Parameters:
+
+	Governor - Receives the governor
+	CpuBudget - The share of one core the sweep may use, e.g. 0.05 for 5%, 0 for no limit
+	SweepPeriod - The period to complete a sweep in, 0 to sweep as often as the budget allows
+	StaleSweeps - The most sweeps between two checks of a page, 1 unless the sweeps skip stable pages or only check written ones
+
+Return Value:
+
+	None
+
+--*/
+void StartGovernor(SCAN_GOVERNOR& Governor, double CpuBudget, std::chrono::nanoseconds SweepPeriod, size_t StaleSweeps)
+{
+	Governor.CpuBudget = CpuBudget;
+	Governor.SweepPeriod = SweepPeriod;
+	Governor.StaleSweeps = (std::max)(static_cast<size_t>(1), StaleSweeps);
+	Governor.Throughput = 0;
+	Governor.SweepBytes = 0;
+	Governor.SweepStart = std::chrono::steady_clock::now();
+	Governor.SliceStart = Governor.SweepStart;
+	Governor.ReportStart = Governor.SweepStart;
+	Governor.BudgetClock = Governor.SweepStart;
+	Governor.BusyTime = std::chrono::nanoseconds::zero();
+	Governor.PeriodSum = std::chrono::nanoseconds::zero();
+	Governor.PeriodMax = std::chrono::nanoseconds::zero();
+	Governor.Sweeps = 0;
+
+#if defined(_WIN32)
+	//
+	// Sleep on a high resolution waitable timer (Windows 10 1803+), the default timer resolution is 15.6 ms
+	//
+
+	Governor.Timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!Governor.Timer)
+	{
+		Governor.Timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+	}
+#endif
+}
+
+// the bytes the next slice may hash, about GOVERNOR_SLICE of work once the throughput is known
+SIZE_T GovernorSliceBytes(const SCAN_GOVERNOR& Governor)
+{
+	if (Governor.CpuBudget <= 0 && Governor.SweepPeriod.count() <= 0)
+	{
+		return SIZE_MAX;
+	}
+
+	double Bytes = Governor.Throughput * std::chrono::duration<double>(GOVERNOR_SLICE).count();
+	return (std::max)(static_cast<SIZE_T>(GOVERNOR_MIN_SLICE_BYTES), static_cast<SIZE_T>(Bytes));
+}
+
+void GovernorBeginSlice(SCAN_GOVERNOR& Governor)
+{
+	Governor.SliceStart = std::chrono::steady_clock::now();
+}
+
+/*++
+
+Routine Description:
+
+	Accounts the CPU time of a slice and the throughput it hashed at, and advances the budget clock by the slice's CPU time
+	divided by CpuBudget, from the later of the clock and the slice's start
+
+Parameters:
+
+	Governor - The governor
+	SliceStart - When the slice started
+	SliceEnd - When the slice ended
+	Hashed - The bytes the slice hashed
+	Threads - The number of threads the slice ran on, its CPU time is charged as its duration times Threads
+
+Return Value:
+
+	GOVERNOR_TIME - The budget clock, the earliest the next slice may start, SliceEnd when there is no budget
+
+--*/
+GOVERNOR_TIME GovernorChargeSlice(SCAN_GOVERNOR& Governor, GOVERNOR_TIME SliceStart, GOVERNOR_TIME SliceEnd, SIZE_T Hashed, size_t Threads)
+{
+	std::chrono::nanoseconds Busy = SliceEnd - SliceStart;
+	std::chrono::nanoseconds Charged = Busy * static_cast<long long>((std::max)(static_cast<size_t>(1), Threads));
+	Governor.BusyTime += Charged;
+
+	//
+	// Smooth the throughput over the last few slices, small slices (dirty sweeps) say little about it
+	//
+
+	if (Hashed >= GOVERNOR_MIN_SLICE_BYTES && Busy.count() > 0)
+	{
+		double Throughput = Hashed / std::chrono::duration<double>(Busy).count();
+		Governor.Throughput = Governor.Throughput > 0 ? Governor.Throughput * 0.75 + Throughput * 0.25 : Throughput;
+	}
+
+	if (Governor.CpuBudget <= 0)
+	{
+		return SliceEnd;
+	}
+
+	Governor.BudgetClock = (std::max)(Governor.BudgetClock, SliceStart) + std::chrono::duration_cast<std::chrono::nanoseconds>(Charged / Governor.CpuBudget);
+	return Governor.BudgetClock;
+}
+
+static void GovernorSleepUntil(SCAN_GOVERNOR& Governor, GOVERNOR_TIME Deadline)
+{
+#if defined(_WIN32)
+	std::chrono::nanoseconds Remaining = Deadline - std::chrono::steady_clock::now();
+	if (Governor.Timer && Remaining.count() > 0)
+	{
+		LARGE_INTEGER DueTime;
+		DueTime.QuadPart = -static_cast<LONGLONG>(Remaining.count() / 100);
+		if (SetWaitableTimer(Governor.Timer, &DueTime, 0, NULL, NULL, FALSE))
+		{
+			WaitForSingleObject(Governor.Timer, INFINITE);
+			return;
+		}
+	}
+#else
+	(void)Governor;
+#endif
+	std::this_thread::sleep_until(Deadline);
+}
+
+/*++
+
+Routine Description:
+
+	Accounts a finished slice and sleeps until the next slice may start
+	Every GOVERNOR_REPORT_INTERVAL the achieved sweep period, the detection latency and the CPU share are reported. A write lands
+	at worst just behind the sweep, so it is detected at most one sweep period after it happened: the longest period is the
+	detection latency bound, StaleSweeps times it for the pages checked least often
+
+Parameters:
+
+	Governor - The governor
+	Hashed - The bytes the slice hashed
+	Threads - The number of threads that ran the slice, its CPU time is charged as its duration times Threads
+	TableBytes - The bytes of the whole page table, a full sweep hashes them all
+	SweepComplete - true when the slice completed a sweep
+
+Return Value:
+
+	None
+
+--*/
+void GovernorEndSlice(SCAN_GOVERNOR& Governor, SIZE_T Hashed, size_t Threads, SIZE_T TableBytes, bool SweepComplete)
+{
+	GOVERNOR_TIME Now = std::chrono::steady_clock::now();
+	GOVERNOR_TIME Deadline = GovernorChargeSlice(Governor, Governor.SliceStart, Now, Hashed, Threads);
+	Governor.SweepBytes += Hashed;
+	if (Governor.SweepPeriod.count() > 0)
+	{
+		double Progress = SweepComplete || !TableBytes ? 1.0 : (std::min)(1.0, static_cast<double>(Governor.SweepBytes) / TableBytes);
+		Deadline = (std::max)(Deadline, Governor.SweepStart + std::chrono::duration_cast<std::chrono::nanoseconds>(Governor.SweepPeriod * Progress));
+	}
+
+	if (Deadline > Now)
+	{
+		GovernorSleepUntil(Governor, Deadline);
+	}
+
+	if (SweepComplete)
+	{
+		GOVERNOR_TIME End = std::chrono::steady_clock::now();
+		std::chrono::nanoseconds Period = End - Governor.SweepStart;
+		Governor.PeriodSum += Period;
+		Governor.PeriodMax = (std::max)(Governor.PeriodMax, Period);
+		Governor.Sweeps++;
+		Governor.SweepStart = End;
+		Governor.SweepBytes = 0;
+
+		std::chrono::nanoseconds Elapsed = End - Governor.ReportStart;
+		if (Elapsed >= GOVERNOR_REPORT_INTERVAL)
+		{
+			double Milliseconds = 1000.0;
+			std::cout << std::dec << "Sweep period: " << std::chrono::duration<double>(Governor.PeriodSum).count() * Milliseconds / Governor.Sweeps
+				<< " ms (target " << std::chrono::duration<double>(Governor.SweepPeriod).count() * Milliseconds
+				<< " ms) | Detection latency: <= " << std::chrono::duration<double>(Governor.PeriodMax).count() * Milliseconds
+				<< " ms (stable pages <= " << std::chrono::duration<double>(Governor.PeriodMax).count() * Milliseconds * Governor.StaleSweeps
+				<< " ms) | CPU: " << 100.0 * std::chrono::duration<double>(Governor.BusyTime).count() / std::chrono::duration<double>(Elapsed).count()
+				<< "% of one core (budget " << Governor.CpuBudget * 100.0 << "%)" << std::endl;
+
+			Governor.ReportStart = End;
+			Governor.BusyTime = std::chrono::nanoseconds::zero();
+			Governor.PeriodSum = std::chrono::nanoseconds::zero();
+			Governor.PeriodMax = std::chrono::nanoseconds::zero();
+			Governor.Sweeps = 0;
+		}
+	}
+}
+
+void StopGovernor(SCAN_GOVERNOR& Governor)
+{
+#if defined(_WIN32)
+	if (Governor.Timer)
+	{
+		CloseHandle(Governor.Timer);
+	}
+	Governor.Timer = NULL;
+#else
+	(void)Governor;
+#endif
+}
@@ -0,0 +1,72 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+#include <chrono>
+#include "platform.h"
+
+//
+// Scan Governor
+// Paces the sweep loop so it stays within a CPU budget (a share of one core) and sweeps at a target period, instead of spinning.
+// Every slice of a sweep is sized to about GOVERNOR_SLICE of work at the measured hashing throughput, and the sweeping thread
+// sleeps until the later of two deadlines before the next slice:
+//  - the period deadline, the slices of a sweep spread evenly over SweepPeriod, so a sweep completes once per period
+//  - the budget deadline, the slice's CPU time (its duration times the threads that ran it) divided by CpuBudget
+// When the budget cannot sustain the period the period slips, which the periodic report shows
+// Threads sweeping slices concurrently share one governor through GovernorChargeSlice (under their own lock): every slice pushes
+// the budget clock further by its CPU time divided by CpuBudget, and no slice starts before the clock
+//
+
+#define GOVERNOR_SLICE std::chrono::microseconds(1000)
+#define GOVERNOR_MIN_SLICE_BYTES (64 * 1024)
+#define GOVERNOR_REPORT_INTERVAL std::chrono::seconds(10)
+
+typedef std::chrono::steady_clock::time_point GOVERNOR_TIME;
+
+typedef struct _SCAN_GOVERNOR
+{
+	double CpuBudget;
+	std::chrono::nanoseconds SweepPeriod;
+	size_t StaleSweeps;
+	double Throughput;
+	SIZE_T SweepBytes;
+	GOVERNOR_TIME SweepStart;
+	GOVERNOR_TIME SliceStart;
+	GOVERNOR_TIME ReportStart;
+	GOVERNOR_TIME BudgetClock;
+	std::chrono::nanoseconds BusyTime;
+	std::chrono::nanoseconds PeriodSum;
+	std::chrono::nanoseconds PeriodMax;
+	size_t Sweeps;
+#if defined(_WIN32)
+	HANDLE Timer;
+#endif
+} SCAN_GOVERNOR;
+
+void StartGovernor(SCAN_GOVERNOR& Governor, double CpuBudget, std::chrono::nanoseconds SweepPeriod, size_t StaleSweeps = 1);
+SIZE_T GovernorSliceBytes(const SCAN_GOVERNOR& Governor);
+void GovernorBeginSlice(SCAN_GOVERNOR& Governor);
+GOVERNOR_TIME GovernorChargeSlice(SCAN_GOVERNOR& Governor, GOVERNOR_TIME SliceStart, GOVERNOR_TIME SliceEnd, SIZE_T Hashed, size_t Threads);
+void GovernorEndSlice(SCAN_GOVERNOR& Governor, SIZE_T Hashed, size_t Threads, SIZE_T TableBytes, bool SweepComplete);
+void StopGovernor(SCAN_GOVERNOR& Governor);
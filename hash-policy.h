@@ -0,0 +1,392 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include "error-checking.h"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#define XXH_SSE2
+#endif
+
+//
+// Hash policies the page scanner is instantiated over (EvaluatePageList<HashPolicy>)
+// A full sweep checksums rows up to ScanSweepChunk bytes with the policy. Larger rows, and the pages rechecked for dirty tracking and write
+// traps, are checked through the checksum trees instead (CRC32 sums, see checksum-tree.h)
+// A policy provides:
+//	Checksum - the recorded checksum type, comparable with == and printable with <<
+//	Compute(Data, Size) - a new checksum of the data
+//	Recompute(Data, Size, Recorded) - a checksum of the data comparable with Recorded (e.g. same CRC polynomial)
+// Everything is static and inline so the hash is compiled into the scan loop, no virtual dispatch
+//
+
+//
+// CRC checksum tagged with the polynomial that produced it (see crc_polynomial)
+//
+
+typedef struct _CRC_CHECKSUM
+{
+	unsigned int Value;
+	crc_polynomial Polynomial;
+} CRC_CHECKSUM;
+
+inline bool operator==(const CRC_CHECKSUM& Left, const CRC_CHECKSUM& Right)
+{
+	return Left.Value == Right.Value && Left.Polynomial == Right.Polynomial;
+}
+
+inline bool operator!=(const CRC_CHECKSUM& Left, const CRC_CHECKSUM& Right)
+{
+	return !(Left == Right);
+}
+
+inline std::ostream& operator<<(std::ostream& Stream, const CRC_CHECKSUM& Checksum)
+{
+	return Stream << std::hex << Checksum.Value << (Checksum.Polynomial == crc_polynomial_castagnoli ? " (crc32c)" : " (crc32)");
+}
+
+//
+// 128-bit checksum, two 64-bit halves
+//
+
+typedef struct _HASH128
+{
+	unsigned long long Low;
+	unsigned long long High;
+} HASH128;
+
+inline bool operator==(const HASH128& Left, const HASH128& Right)
+{
+	return Left.Low == Right.Low && Left.High == Right.High;
+}
+
+inline bool operator!=(const HASH128& Left, const HASH128& Right)
+{
+	return !(Left == Right);
+}
+
+inline std::ostream& operator<<(std::ostream& Stream, const HASH128& Checksum)
+{
+	std::ios_base::fmtflags Flags = Stream.flags();
+	char Fill = Stream.fill('0');
+	Stream << std::hex;
+	Stream.width(16);
+	Stream << Checksum.High;
+	Stream.width(16);
+	Stream << Checksum.Low;
+	Stream.fill(Fill);
+	Stream.flags(Flags);
+	return Stream;
+}
+
+//
+// XXH3-style hash core: 8 64-bit accumulators consume 64-byte stripes with a 32x32->64 multiply per lane,
+// and are scrambled after every 1 KiB block. The secret is a fixed 192-byte key (splitmix64 output),
+// so values are not interchangeable with the reference XXH3, only with themselves
+//
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define XXH_STRIPE_LEN 64
+#define XXH_SECRET_SIZE 192
+#define XXH_SECRET_CONSUME_RATE 8
+#define XXH_STRIPES_PER_BLOCK ((XXH_SECRET_SIZE - XXH_STRIPE_LEN) / XXH_SECRET_CONSUME_RATE)
+#define XXH_BLOCK_LEN (XXH_STRIPE_LEN * XXH_STRIPES_PER_BLOCK)
+
+alignas(64) static const unsigned long long XxhSecret[XXH_SECRET_SIZE / sizeof(unsigned long long)] =
+{
+	0x832523062BDA8CF0ULL, 0xFD863C0F5B724A33ULL, 0x65549EC224FDCBE0ULL,
+	0x96B7A2B1955B0FADULL, 0x51372CA0D9B9BD03ULL, 0x5D54A9593D5DA5F8ULL,
+	0xAB2518D8B1A9FC15ULL, 0x662D7C976E6E78D9ULL, 0xFCA8C5E463510926ULL,
+	0x0E00186D1666CC02ULL, 0x0A7EAB3EB95188FAULL, 0xEC4F66484DD1ED41ULL,
+	0x26D55AEF9BE2D444ULL, 0x016C952840FBCF5EULL, 0xADB7763CD7BE49D0ULL,
+	0x679685AA3FA7FBF5ULL, 0x8834395F7A7A49EBULL, 0x25DA3138142D8BD7ULL,
+	0x977690DFCEB082E5ULL, 0x8C8934DA0AA0BED4ULL, 0xB19B40829A125F36ULL,
+	0xA2D76530DDAE1050ULL, 0x8603BF98A9219E5AULL, 0x5F43FE897D8A260AULL,
+};
+
+inline unsigned long long XxhRead64(const unsigned char* Data)
+{
+	unsigned long long Value;
+	memcpy(&Value, Data, sizeof(Value));
+	return Value;
+}
+
+inline unsigned long long XxhMul128Fold64(unsigned long long Left, unsigned long long Right)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long long High;
+	unsigned long long Low = _umul128(Left, Right, &High);
+	return Low ^ High;
+#elif defined(__SIZEOF_INT128__)
+	unsigned __int128 Product = (unsigned __int128)Left * Right;
+	return (unsigned long long)Product ^ (unsigned long long)(Product >> 64);
+#else
+	unsigned long long LoLo = (Left & 0xFFFFFFFF) * (Right & 0xFFFFFFFF);
+	unsigned long long HiLo = (Left >> 32) * (Right & 0xFFFFFFFF);
+	unsigned long long LoHi = (Left & 0xFFFFFFFF) * (Right >> 32);
+	unsigned long long HiHi = (Left >> 32) * (Right >> 32);
+	unsigned long long Cross = (LoLo >> 32) + (HiLo & 0xFFFFFFFF) + LoHi;
+	unsigned long long Upper = (HiLo >> 32) + (Cross >> 32) + HiHi;
+	unsigned long long Lower = (Cross << 32) | (LoLo & 0xFFFFFFFF);
+	return Lower ^ Upper;
+#endif
+}
+
+inline unsigned long long XxhAvalanche(unsigned long long Hash)
+{
+	Hash ^= Hash >> 37;
+	Hash *= 0x165667919E3779F9ULL;
+	Hash ^= Hash >> 32;
+	return Hash;
+}
+
+//
+// The stripe and scramble steps over the accumulator lanes. x64 always has SSE2, so there they run on two lanes per register
+// (_mm_mul_epu32 is the 32x32->64 multiply of both lanes), elsewhere on one lane at a time. Both produce the same values
+//
+
+#if defined(XXH_SSE2)
+typedef __m128i XXH_LANES;
+#define XXH_LANE_COUNT 4
+
+inline __m128i XxhAccumulatePair(__m128i Acc, const unsigned char* Input, const unsigned char* Secret)
+{
+	__m128i DataValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Input));
+	__m128i DataKey = _mm_xor_si128(DataValue, _mm_loadu_si128(reinterpret_cast<const __m128i*>(Secret)));
+	__m128i Product = _mm_mul_epu32(DataKey, _mm_shuffle_epi32(DataKey, _MM_SHUFFLE(0, 3, 0, 1)));
+	return _mm_add_epi64(Acc, _mm_add_epi64(Product, _mm_shuffle_epi32(DataValue, _MM_SHUFFLE(1, 0, 3, 2))));
+}
+
+// unrolled by hand, a loop over the pairs is not always unrolled and then keeps the lanes in memory
+inline void XxhAccumulateStripe(XXH_LANES* Acc, const unsigned char* Input, const unsigned char* Secret)
+{
+	Acc[0] = XxhAccumulatePair(Acc[0], Input, Secret);
+	Acc[1] = XxhAccumulatePair(Acc[1], Input + 16, Secret + 16);
+	Acc[2] = XxhAccumulatePair(Acc[2], Input + 32, Secret + 32);
+	Acc[3] = XxhAccumulatePair(Acc[3], Input + 48, Secret + 48);
+}
+
+inline __m128i XxhScramblePair(__m128i Acc, const unsigned char* Secret)
+{
+	const __m128i Prime = _mm_set1_epi32(static_cast<int>(XXH_PRIME32_1));
+	__m128i Value = _mm_xor_si128(Acc, _mm_srli_epi64(Acc, 47));
+	Value = _mm_xor_si128(Value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(Secret)));
+	__m128i Low = _mm_mul_epu32(Value, Prime);
+	__m128i High = _mm_mul_epu32(_mm_srli_epi64(Value, 32), Prime);
+	return _mm_add_epi64(Low, _mm_slli_epi64(High, 32));
+}
+
+inline void XxhScramble(XXH_LANES* Acc, const unsigned char* Secret)
+{
+	Acc[0] = XxhScramblePair(Acc[0], Secret);
+	Acc[1] = XxhScramblePair(Acc[1], Secret + 16);
+	Acc[2] = XxhScramblePair(Acc[2], Secret + 32);
+	Acc[3] = XxhScramblePair(Acc[3], Secret + 48);
+}
+#else
+typedef unsigned long long XXH_LANES;
+#define XXH_LANE_COUNT 8
+
+inline void XxhAccumulateStripe(XXH_LANES* Acc, const unsigned char* Input, const unsigned char* Secret)
+{
+	for (size_t Lane = 0; Lane < XXH_LANE_COUNT; Lane++)
+	{
+		unsigned long long DataValue = XxhRead64(Input + Lane * 8);
+		unsigned long long DataKey = DataValue ^ XxhRead64(Secret + Lane * 8);
+		Acc[Lane ^ 1] += DataValue;
+		Acc[Lane] += (DataKey & 0xFFFFFFFF) * (DataKey >> 32);
+	}
+}
+
+inline void XxhScramble(XXH_LANES* Acc, const unsigned char* Secret)
+{
+	for (size_t Lane = 0; Lane < XXH_LANE_COUNT; Lane++)
+	{
+		unsigned long long Value = Acc[Lane];
+		Value ^= Value >> 47;
+		Value ^= XxhRead64(Secret + Lane * 8);
+		Acc[Lane] = Value * XXH_PRIME32_1;
+	}
+}
+#endif
+
+inline void XxhAccumulate(unsigned long long* Acc, const void* Data, size_t Size)
+{
+	const unsigned char* Input = static_cast<const unsigned char*>(Data);
+	const unsigned char* Secret = reinterpret_cast<const unsigned char*>(XxhSecret);
+
+	Acc[0] = XXH_PRIME32_3;
+	Acc[1] = XXH_PRIME64_1;
+	Acc[2] = XXH_PRIME64_2;
+	Acc[3] = XXH_PRIME64_3;
+	Acc[4] = XXH_PRIME64_4;
+	Acc[5] = XXH_PRIME32_2;
+	Acc[6] = XXH_PRIME64_5;
+	Acc[7] = XXH_PRIME32_1;
+
+	//
+	// The lanes stay in registers for the whole input, Acc only receives them at the end
+	//
+
+	XXH_LANES Lanes[XXH_LANE_COUNT];
+	memcpy(Lanes, Acc, sizeof(Lanes));
+
+	//
+	// Inputs shorter than a stripe are zero padded into a single stripe, the length is mixed in by the merge
+	//
+
+	if (Size < XXH_STRIPE_LEN)
+	{
+		unsigned char Stripe[XXH_STRIPE_LEN] = { 0 };
+		if (Size)
+		{
+			memcpy(Stripe, Input, Size);
+		}
+		XxhAccumulateStripe(Lanes, Stripe, Secret);
+		memcpy(Acc, Lanes, sizeof(Lanes));
+		return;
+	}
+
+	size_t Blocks = (Size - 1) / XXH_BLOCK_LEN;
+	for (size_t Block = 0; Block < Blocks; Block++)
+	{
+		for (size_t Stripe = 0; Stripe < XXH_STRIPES_PER_BLOCK; Stripe++)
+		{
+			XxhAccumulateStripe(Lanes, Input + Block * XXH_BLOCK_LEN + Stripe * XXH_STRIPE_LEN, Secret + Stripe * XXH_SECRET_CONSUME_RATE);
+		}
+		XxhScramble(Lanes, Secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN);
+	}
+
+	//
+	// Remaining full stripes of the last block, then the last 64 bytes (overlapping) with a distinct secret offset
+	//
+
+	size_t Stripes = ((Size - 1) - Blocks * XXH_BLOCK_LEN) / XXH_STRIPE_LEN;
+	for (size_t Stripe = 0; Stripe < Stripes; Stripe++)
+	{
+		XxhAccumulateStripe(Lanes, Input + Blocks * XXH_BLOCK_LEN + Stripe * XXH_STRIPE_LEN, Secret + Stripe * XXH_SECRET_CONSUME_RATE);
+	}
+
+	XxhAccumulateStripe(Lanes, Input + Size - XXH_STRIPE_LEN, Secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN - 7);
+	memcpy(Acc, Lanes, sizeof(Lanes));
+}
+
+inline unsigned long long XxhMerge(const unsigned long long* Acc, const unsigned char* Secret, unsigned long long Start)
+{
+	unsigned long long Result = Start;
+	for (size_t Pair = 0; Pair < 4; Pair++)
+	{
+		Result += XxhMul128Fold64(Acc[Pair * 2] ^ XxhRead64(Secret + Pair * 16), Acc[Pair * 2 + 1] ^ XxhRead64(Secret + Pair * 16 + 8));
+	}
+	return XxhAvalanche(Result);
+}
+
+//
+// Legacy CRC32, 32 bits, hardware accelerated (see crc_initialize), calling the selected engine directly (see crc_crypt_direct)
+//
+
+struct Crc32Policy
+{
+	typedef CRC_CHECKSUM Checksum;
+
+	static inline Checksum Compute(const void* Data, size_t Size)
+	{
+		Checksum Result;
+		Result.Polynomial = crc_active_polynomial;
+		Result.Value = crc_crypt_direct(Result.Polynomial, const_cast<void*>(Data), static_cast<crc_size>(Size));
+		return Result;
+	}
+
+	static inline Checksum Recompute(const void* Data, size_t Size, const Checksum& Recorded)
+	{
+		Checksum Result;
+		Result.Polynomial = Recorded.Polynomial;
+		Result.Value = crc_crypt_direct(Result.Polynomial, const_cast<void*>(Data), static_cast<crc_size>(Size));
+		return Result;
+	}
+};
+
+//
+// XXH3-style 64-bit hash, for the checksum width rather than speed: on x64 (SSE2 lanes) a 4 KiB page costs about as much as
+// the pclmul CRC32 engine, and a sweep larger than the caches is bound by memory either way. It is only ahead of Crc32Policy
+// where the CRC falls back to slice16
+//
+
+struct Xxh3Policy
+{
+	typedef unsigned long long Checksum;
+
+	static inline Checksum Compute(const void* Data, size_t Size)
+	{
+		unsigned long long Acc[8];
+		XxhAccumulate(Acc, Data, Size);
+		return XxhMerge(Acc, reinterpret_cast<const unsigned char*>(XxhSecret) + 11, Size * XXH_PRIME64_1);
+	}
+
+	static inline Checksum Recompute(const void* Data, size_t Size, const Checksum&)
+	{
+		return Compute(Data, Size);
+	}
+};
+
+//
+// XXH3-style 128-bit hash, one accumulation pass merged twice with different secret offsets
+//
+
+struct Hash128Policy
+{
+	typedef HASH128 Checksum;
+
+	static inline Checksum Compute(const void* Data, size_t Size)
+	{
+		unsigned long long Acc[8];
+		XxhAccumulate(Acc, Data, Size);
+
+		const unsigned char* Secret = reinterpret_cast<const unsigned char*>(XxhSecret);
+		Checksum Result;
+		Result.Low = XxhMerge(Acc, Secret + 11, Size * XXH_PRIME64_1);
+		Result.High = XxhMerge(Acc, Secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN - 11, ~(Size * XXH_PRIME64_2));
+		return Result;
+	}
+
+	static inline Checksum Recompute(const void* Data, size_t Size, const Checksum&)
+	{
+		return Compute(Data, Size);
+	}
+};
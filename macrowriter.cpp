@@ -24,105 +24,264 @@
 
 #include "pch.h"
 #include "macrowriter.h"
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include "error-checking.h"
+
+//
+// Appends the decimal digits of a number, formatted in place without a temporary string
+//
+
+static void AppendNumber(std::string& Text, unsigned long long Value)
+{
+	char Digits[20];
+	std::to_chars_result Result = std::to_chars(Digits, Digits + sizeof(Digits), Value);
+	Text.append(Digits, Result.ptr);
+}
+
+//
+// Appends the declaration and opening brace of a macro function
+//
+
+static void AppendHeader(std::string& Text, const char* Prefix, const char* MacroName)
+{
+	Text += "void ";
+	Text += Prefix;
+	Text += MacroName;
+	Text += "(HANDLE ProcessHandle, BYTE* ModuleBase)\n{\n";
+}
 
 /*++
 
 Routine Description:
 
-	Generates a C-compatible macro function from the list of changed bytes and their locations
-	Operates on the notion that the process handle will be passed upon call
+	Appends the statements of one range to a macro: a static buffer of its bytes, 16 to a line, and one WriteProcessMemory of it
+	The ranges were already coalesced (unchanged bytes in small gaps between changes are carried in them),
+	so a patch costs one write per run instead of one per byte
 
 Parameters:
 
-	MacroName - The name of the macro generated
-	List - the list of changes, to be parsed into program statements for a macro
+	Text - The macro being written
+	Item - The index of the range, names the buffer
+	Offset - The offset of the range from the module base, decimal formatted
+	Bytes - The bytes of the range
+	Length - The number of bytes
 
 Return Value:
 
-	A macro, a sequence of program statements
+	None
 
 --*/
-std::vector<std::pair<std::string, std::string>> GeneratePairMacro(std::string MacroName, std::vector<std::pair<BYTE, PVOID>> List)
+static void AppendRange(std::string& Text, size_t Item, SIZE_T Offset, const BYTE* Bytes, SIZE_T Length)
 {
+	Text += "\tstatic const BYTE Buffer";
+	AppendNumber(Text, Item);
+	Text += "[] = {";
+
 	//
-	// Store program statements in a vector to parse for output
+	// Format a line of 16 bytes at a time into a local buffer, then append it whole
 	//
 
-	std::vector<std::pair<std::string, std::string>> Macros;
+	for (SIZE_T Index = 0; Index < Length; Index += 16)
+	{
+		char Line[3 + 16 * 5];
+		char* Cursor = Line;
+		SIZE_T End = Index + 16 < Length ? Index + 16 : Length;
+
+		*Cursor++ = '\n';
+		*Cursor++ = '\t';
+		*Cursor++ = '\t';
+		for (SIZE_T Byte = Index; Byte < End; Byte++)
+		{
+			Cursor = std::to_chars(Cursor, Line + sizeof(Line), Bytes[Byte]).ptr;
+			if (Byte + 1 < Length)
+			{
+				*Cursor++ = ',';
+				if (Byte + 1 < End)
+				{
+					*Cursor++ = ' ';
+				}
+			}
+		}
+
+		Text.append(Line, Cursor);
+	}
+
+	Text += "\n\t};\n\tWriteProcessMemory(ProcessHandle, ModuleBase + ";
+	AppendNumber(Text, Offset);
+	Text += ", Buffer";
+	AppendNumber(Text, Item);
+	Text += ", sizeof(Buffer";
+	AppendNumber(Text, Item);
+	Text += "), NULL);\n\n";
+}
+
+/*++
 
+Routine Description:
+
+	Generates C-compatible macro functions from the ranges of changed bytes and their locations, one writing the changed bytes
+	and one (Undo<MacroName>) writing the original bytes back, both in one pass over the ranges
+	Operates on the notion that the process handle and the base of the module in that process will be passed upon call,
+	the ranges are written at their offsets from the module base so the macros work wherever the module was loaded
+
+Parameters:
+
+	Writer - Receives the macros, replacing the ones it held
+	MacroName - The name of the macro generated
+	Diff - the coalesced ranges of changes, to be parsed into program statements for a macro
+
+Return Value:
+
+	None
+
+--*/
+void WritePairMacro(MACRO_WRITER& Writer, const std::string& MacroName, const DIFF_SET& Diff)
+{
 	//
 	// If macro/function name is not specified, use a default name
 	//
 
-	if (MacroName == "")
-	{
-		MacroName = "DefaultMacroName";
-	}
+	const char* Name = MacroName.empty() ? "DefaultMacroName" : MacroName.c_str();
 
 	//
-	// Parse the function name into a declaration, then iterate over each needed WriteProcessMemory sequence
+	// Reserve for the longest a macro can get: about 5 characters per byte, a line per 16 bytes and the statements per range
 	//
 
-	std::string FunctionInit = "void " + MacroName + "(HANDLE ProcessHandle)\n{\n";
-	std::string FunctionEnd = "}";
+	size_t Reserve = 64 + strlen(Name);
+	for (const DIFF_RANGE& Range : Diff.Ranges)
+	{
+		Reserve += 160 + Range.Length * 5 + Range.Length / 4;
+	}
+
+	Writer.Apply.clear();
+	Writer.Undo.clear();
+	Writer.Apply.reserve(Reserve);
+	Writer.Undo.reserve(Reserve);
 
-	Macros.push_back({ FunctionInit, FunctionEnd });
+	AppendHeader(Writer.Apply, "", Name);
+	AppendHeader(Writer.Undo, "Undo", Name);
 
-	for (size_t Item = 0; Item < List.size(); Item++)
+	size_t Item = 0;
+	for (const DIFF_RANGE& Range : Diff.Ranges)
 	{
-		//
-		// Create a buffer named after the item index
-		// Set the buffer to the first value of the Item in List[Item]
-		//
+		SIZE_T Offset = DiffRangeOffset(Diff, Range);
+		AppendRange(Writer.Apply, Item, Offset, DiffRangeBytes(Diff, Range, DiffApply), Range.Length);
+		AppendRange(Writer.Undo, Item, Offset, DiffRangeBytes(Diff, Range, DiffUndo), Range.Length);
+		Item++;
+	}
+
+	Writer.Apply += "}\n\n";
+	Writer.Undo += "}\n\n";
+}
 
-		std::string VarInit = "\tBYTE Buffer" + std::to_string(Item);
-		VarInit += " = " + std::to_string(List[Item].first) + "L;\n";
+/*++
 
-		//
-		// Write the BufferN to the process using the decimal formatted second value of the Item in List[Item], indicating the virtual address
-		//
+Routine Description:
 
-		std::string WriteInit = "\tWriteProcessMemory(ProcessHandle, (PVOID)";
-		WriteInit += std::to_string((DWORD_PTR)List[Item].second) + "L, &Buffer" + std::to_string(Item) + ", 1, NULL);\n\n";
+	Outputs the macro and its undo, as two writes to the sink
 
-		Macros.push_back({ VarInit, WriteInit });
-	}
+Parameters:
+
+	Writer - The macros written by WritePairMacro
+	Sink - The stream to output to, e.g. std::cout
+
+Return Value:
 
-	return Macros;
+	None
+
+--*/
+void OutputMacro(MACRO_WRITER& Writer, std::ostream& Sink)
+{
+	Sink.write(Writer.Apply.data(), Writer.Apply.size());
+	Sink.write(Writer.Undo.data(), Writer.Undo.size());
+	Sink.flush();
 }
 
+// appends Length bytes to the patch, then zeroes up to the next PATCH_ALIGNMENT boundary
+static void AppendPatch(std::vector<BYTE>& Patch, const void* Data, SIZE_T Length)
+{
+	const BYTE* Bytes = static_cast<const BYTE*>(Data);
+	Patch.insert(Patch.end(), Bytes, Bytes + Length);
+	Patch.resize(PatchAlign(Patch.size()), 0);
+}
 
 /*++
 
 Routine Description:
 
-	Outputs the parsed macro to the CLI
+	Generates the binary patch file of a change (see patch-file.h): a record per range, at its offset from the module base,
+	carrying the changed and the original bytes and the CRC32C of both
 
 Parameters:
 
-	Macros - The sequence of program statements that make up the macro to be parsed and displayed
+	Writer - Receives the patch in Writer.Patch, replacing the one it held
+	ModuleBase - The base of the diff's module in the process the change was captured in, recorded for reference only
+	Diff - The coalesced ranges of changes
 
 Return Value:
 
-	None
+	DWORD - 0, or ERROR_INVALID_PARAMETER when the module name cannot be converted to the current locale, Patch is then empty
+		(an empty name would make the patch apply to the main executable)
 
 --*/
-void OutputMacro(std::vector<std::pair<std::string, std::string>> Macros)
+DWORD WritePatch(MACRO_WRITER& Writer, PVOID ModuleBase, const DIFF_SET& Diff)
 {
-	//
-	// Function header initialization
-	//
+	Writer.Patch.clear();
 
-	std::cout << Macros[0].first;
+	std::wstring ModuleName = QueryModuleName(Diff.Module);
+	std::string Name;
+	if (!ModuleName.empty())
+	{
+		size_t Length = std::wcstombs(NULL, ModuleName.c_str(), 0);
+		if (Length == static_cast<size_t>(-1))
+		{
+			return ERROR_INVALID_PARAMETER;
+		}
+		Name.resize(Length + 1);
+		Name.resize(std::wcstombs(&Name[0], ModuleName.c_str(), Name.size()));
+	}
 
-	for (std::size_t MacIndex = 1; MacIndex < Macros.size(); MacIndex++)
+	SIZE_T Reserve = sizeof(PATCH_HEADER) + PatchAlign(Name.size()) + sizeof(PATCH_TRAILER);
+	for (const DIFF_RANGE& Range : Diff.Ranges)
 	{
-		std::cout << Macros[MacIndex].first << Macros[MacIndex].second;
+		Reserve += PatchAlign(sizeof(PATCH_RECORD) + 2 * Range.Length);
 	}
 
-	//
-	// End of function, second pair value of the first macro
-	//
+	Writer.Patch.reserve(Reserve);
+
+	PATCH_HEADER Header = { PATCH_MAGIC, PATCH_VERSION, static_cast<DWORD>(Diff.Ranges.size()), static_cast<DWORD>(Name.size()),
+		reinterpret_cast<DWORD_PTR>(ModuleBase), Reserve };
+	AppendPatch(Writer.Patch, &Header, sizeof(Header));
+	AppendPatch(Writer.Patch, Name.data(), Name.size());
+
+	for (const DIFF_RANGE& Range : Diff.Ranges)
+	{
+		const BYTE* Changed = DiffRangeBytes(Diff, Range, DiffApply);
+		const BYTE* Original = DiffRangeBytes(Diff, Range, DiffUndo);
+
+		PATCH_RECORD Record = { 0 };
+		Record.Offset = DiffRangeOffset(Diff, Range);
+		Record.Length = static_cast<DWORD>(Range.Length);
+		Record.NewHash = crc32c_crypt(const_cast<BYTE*>(Changed), static_cast<crc_size>(Range.Length));
+		Record.OldHash = crc32c_crypt(const_cast<BYTE*>(Original), static_cast<crc_size>(Range.Length));
+
+		Writer.Patch.insert(Writer.Patch.end(), reinterpret_cast<const BYTE*>(&Record), reinterpret_cast<const BYTE*>(&Record + 1));
+		Writer.Patch.insert(Writer.Patch.end(), Changed, Changed + Range.Length);
+		AppendPatch(Writer.Patch, Original, Range.Length);
+	}
+
+	PATCH_TRAILER Trailer = { crc32c_crypt(Writer.Patch.data(), static_cast<crc_size>(Writer.Patch.size())), PATCH_MAGIC };
+	AppendPatch(Writer.Patch, &Trailer, sizeof(Trailer));
+	return 0;
+}
 
-	std::cout << Macros[0].second << "\n" << std::endl;
+// writes the patch generated by WritePatch to a file, false when it could not be written
+bool OutputPatch(const MACRO_WRITER& Writer, const std::string& Path)
+{
+	std::ofstream File(Path, std::ios::binary | std::ios::trunc);
+	File.write(reinterpret_cast<const char*>(Writer.Patch.data()), Writer.Patch.size());
+	return static_cast<bool>(File.flush());
 }
@@ -26,7 +26,26 @@
 #include <string>
 #include <vector>
 #include <iostream>
-#include <Windows.h>
+#include "platform.h"
+#include "diff-range.h"
+#include "patch-file.h"
 
-std::vector<std::pair<std::string, std::string>> GeneratePairMacro(std::string MacroName, std::vector<std::pair<BYTE, PVOID>> List);
-void OutputMacro(std::vector<std::pair<std::string, std::string>> Macros);
+//
+// Macro Writer
+// Formats the macro of a change and its undo straight into two reusable text buffers, in one pass over the ranges
+// Numbers are formatted with std::to_chars and each buffer grows to the largest macro written, so a steady stream of changes
+// does not allocate
+// WritePatch writes the same change as a binary patch file (see patch-file.h) into Patch, likewise reused
+//
+
+typedef struct _MACRO_WRITER
+{
+	std::string Apply;
+	std::string Undo;
+	std::vector<BYTE> Patch;
+} MACRO_WRITER;
+
+void WritePairMacro(MACRO_WRITER& Writer, const std::string& MacroName, const DIFF_SET& Diff);
+void OutputMacro(MACRO_WRITER& Writer, std::ostream& Sink);
+DWORD WritePatch(MACRO_WRITER& Writer, PVOID ModuleBase, const DIFF_SET& Diff);
+bool OutputPatch(const MACRO_WRITER& Writer, const std::string& Path);
@@ -0,0 +1,100 @@
+#include "pch.h"
+#include "module-table.h"
+#include <map>
+#include <mutex>
+
+//
+// The interned module names, Names[Id] is the name of module Id, never destroyed so ids stay valid for the whole process
+//
+
+typedef struct _MODULE_REGISTRY
+{
+	std::mutex Lock;
+	std::vector<std::wstring> Names = { L"" };
+	std::map<std::wstring, MODULE_ID> Ids = { { L"", MODULE_MAIN_EXECUTABLE } };
+} MODULE_REGISTRY;
+
+static MODULE_REGISTRY& ModuleRegistry = *new MODULE_REGISTRY();
+
+/*++
+
+Routine Description:
+
+	Interns a module name, registering it the first time it is seen
+
+Parameters:
+
+	ModuleName - The name of the module, NULL or empty for the main executable
+
+Return Value:
+
+	MODULE_ID - The id of the module, the same for every call with the same name
+
+--*/
+MODULE_ID RegisterModule(LPCWSTR ModuleName)
+{
+	std::wstring Name = ModuleName ? ModuleName : L"";
+
+	std::lock_guard<std::mutex> Guard(ModuleRegistry.Lock);
+	auto Found = ModuleRegistry.Ids.find(Name);
+	if (Found != ModuleRegistry.Ids.end())
+	{
+		return Found->second;
+	}
+
+	MODULE_ID Module = static_cast<MODULE_ID>(ModuleRegistry.Names.size());
+	ModuleRegistry.Names.push_back(Name);
+	ModuleRegistry.Ids.emplace(Name, Module);
+	return Module;
+}
+
+// the name a module was registered with, empty for the main executable (or an id never registered)
+std::wstring QueryModuleName(MODULE_ID Module)
+{
+	std::lock_guard<std::mutex> Guard(ModuleRegistry.Lock);
+	return Module < ModuleRegistry.Names.size() ? ModuleRegistry.Names[Module] : std::wstring();
+}
+
+void ResetModuleBases(MODULE_BASES& Cache, DWORD ProcessId)
+{
+	Cache.ProcessId = ProcessId;
+	Cache.Bases.clear();
+}
+
+/*++
+
+Routine Description:
+
+	Resolves the base of a module in the cache's process by enumerating its regions, and caches it
+	The slow path of ResolveModuleBase
+
+Parameters:
+
+	Cache - The module bases of the process
+	Module - The module
+	ModuleBase - Receives the base of the module in the process
+
+Return Value:
+
+	DWORD - 0 or the error of EnumerateModuleRegions (e.g. ERROR_FILE_NOT_FOUND when the module is not loaded)
+
+--*/
+DWORD LookupModuleBase(MODULE_BASES& Cache, MODULE_ID Module, PVOID& ModuleBase)
+{
+	std::wstring ModuleName = QueryModuleName(Module);
+
+	PVOID Base = NULL;
+	DWORD StatusCode = EnumerateModuleRegions(Cache.Enumerator, Cache.ProcessId, ModuleName.c_str(), Base, Cache.Regions);
+	if (StatusCode)
+	{
+		return StatusCode;
+	}
+
+	if (Cache.Bases.size() <= Module)
+	{
+		Cache.Bases.resize(Module + 1, NULL);
+	}
+	Cache.Bases[Module] = Base;
+	ModuleBase = Base;
+	return 0;
+}
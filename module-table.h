@@ -0,0 +1,75 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+#include "platform.h"
+#include "regions.h"
+
+//
+// Module Table
+// Changes are addressed as (module id, offset from the module base) rather than by virtual address, so a change captured in one
+// process applies to any instance of the module wherever it was loaded (ASLR)
+// A module id indexes this process's table of interned module names, assigned in registration order, so an id is only meaningful
+// in the process that registered it: 0 is the main executable (the empty name) of whichever process a base is resolved in
+// A change leaves the process keyed by its module name instead: a patch file records the name and OpenPatchFile interns it again,
+// and GetModulePages registers a main executable under its file name, so the name picks the same program in every target
+// The base of a module in a process is resolved by name through that process's MODULE_BASES cache once, relocating an address
+// after that is one addition
+//
+
+typedef DWORD MODULE_ID;
+
+#define MODULE_MAIN_EXECUTABLE 0
+
+MODULE_ID RegisterModule(LPCWSTR ModuleName);
+std::wstring QueryModuleName(MODULE_ID Module);
+
+//
+// The resolved bases of the modules of one process, by module id (NULL until resolved)
+// Retargeted at another process (or a new instance reusing the process id) with ResetModuleBases, used by one thread at a time
+//
+
+typedef struct _MODULE_BASES
+{
+	DWORD ProcessId;
+	std::vector<PVOID> Bases;
+	REGION_ENUMERATOR Enumerator;
+	std::vector<MEM_REGION> Regions;
+} MODULE_BASES;
+
+void ResetModuleBases(MODULE_BASES& Cache, DWORD ProcessId);
+DWORD LookupModuleBase(MODULE_BASES& Cache, MODULE_ID Module, PVOID& ModuleBase);
+
+// the base of a module in the cache's process, enumerating the process only the first time the module is asked for
+inline DWORD ResolveModuleBase(MODULE_BASES& Cache, MODULE_ID Module, PVOID& ModuleBase)
+{
+	if (Module < Cache.Bases.size() && Cache.Bases[Module])
+	{
+		ModuleBase = Cache.Bases[Module];
+		return 0;
+	}
+	return LookupModuleBase(Cache, Module, ModuleBase);
+}
@@ -0,0 +1,107 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "pch.h"
+#include "scan-daemon.h"
+#include <clocale>
+#include <cstdlib>
+#include <string>
+
+/*++
+
+Routine Description:
+
+	Entry point of the standalone monitor, scans modules of other processes out-of-process instead of being injected into them
+	Every process given is a target of one scan daemon, which runs until all of them exited
+	Built as its own executable, separate from the injected library (dllmain.cpp / somain.cpp)
+
+Parameters:
+
+	argv[1..] - The processes to scan, each as <pid> or <pid>:<module>, the main executable when no module is given
+
+--*/
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <pid>[:module] [<pid>[:module] ...]" << std::endl;
+		return 1;
+	}
+
+	//
+	// Module names are converted to wide strings with mbstowcs, which needs the encoding of the environment rather than "C"
+	//
+
+	std::setlocale(LC_ALL, "");
+
+	crc_initialize(crc_engine_automatic);
+	InitializeCompareKernel(CompareKernelAutomatic);
+
+	StartChangeConsumer(CHANGE_QUEUE_CAPACITY, ScanPromptMacroNames, ScanPatchDirectory);
+
+	SCAN_DAEMON<ScanHashPolicy> Daemon;
+	StartScanDaemon(Daemon);
+
+	size_t Targets = 0;
+	for (int Argument = 1; Argument < argc; Argument++)
+	{
+		char* Module = NULL;
+		DWORD ProcessId = static_cast<DWORD>(std::strtoul(argv[Argument], &Module, 10));
+		if (!ProcessId || (*Module && *Module != ':'))
+		{
+			std::cerr << "Invalid target: " << argv[Argument] << std::endl;
+			continue;
+		}
+
+		std::wstring ModuleName;
+		if (*Module == ':')
+		{
+			Module++;
+			size_t Length = std::mbstowcs(NULL, Module, 0);
+			if (Length == static_cast<size_t>(-1))
+			{
+				std::cerr << "Invalid module name: " << argv[Argument] << std::endl;
+				continue;
+			}
+			ModuleName.resize(Length + 1);
+			ModuleName.resize(std::mbstowcs(&ModuleName[0], Module, ModuleName.size()));
+		}
+
+		DWORD StatusCode = AddScanTarget(Daemon, ProcessId, const_cast<LPWSTR>(ModuleName.c_str()));
+		if (StatusCode)
+		{
+			std::cerr << "Process " << ProcessId << " could not be scanned: " << StatusCode << std::endl;
+			continue;
+		}
+		Targets++;
+	}
+
+	if (Targets)
+	{
+		WaitScanDaemon(Daemon);
+	}
+	StopScanDaemon(Daemon);
+	StopChangeConsumer();
+	return Targets ? 0 : 1;
+}
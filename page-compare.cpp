@@ -0,0 +1,200 @@
+#include "pch.h"
+#include "page-compare.h"
+#include "platform.h"
+
+#define COMPARE_BLOCK_SIZE 64
+
+static void FindDifferencesScalar(const unsigned char* Left, const unsigned char* Right, size_t Size, std::vector<size_t>& Offsets);
+static void (*CompareRoutine)(const unsigned char* Left, const unsigned char* Right, size_t Size, std::vector<size_t>& Offsets) = FindDifferencesScalar;
+static COMPARE_KERNEL CompareRoutineKernel = CompareKernelScalar;
+
+static inline unsigned int CompareBitIndex(unsigned long long Mask)
+{
+#if defined(_MSC_VER)
+	unsigned long Index;
+#if defined(_M_X64)
+	_BitScanForward64(&Index, Mask);
+#else
+	if (!_BitScanForward(&Index, static_cast<unsigned long>(Mask)))
+	{
+		_BitScanForward(&Index, static_cast<unsigned long>(Mask >> 32));
+		Index += 32;
+	}
+#endif
+	return Index;
+#else
+	return static_cast<unsigned int>(__builtin_ctzll(Mask));
+#endif
+}
+
+//
+// Emits the offsets of the set bits of a 64-bit difference bitmap (bit n set means byte Base + n differs)
+//
+
+static inline void EmitDifferences(unsigned long long Mask, size_t Base, std::vector<size_t>& Offsets)
+{
+	while (Mask)
+	{
+		Offsets.push_back(Base + CompareBitIndex(Mask));
+		Mask &= Mask - 1;
+	}
+}
+
+static void FindDifferencesScalar(const unsigned char* Left, const unsigned char* Right, size_t Size, std::vector<size_t>& Offsets)
+{
+	for (size_t Offset = 0; Offset < Size; Offset++)
+	{
+		if (Left[Offset] != Right[Offset])
+		{
+			Offsets.push_back(Offset);
+		}
+	}
+}
+
+#if defined(PLATFORM_X86)
+
+static void FindDifferencesSse2(const unsigned char* Left, const unsigned char* Right, size_t Size, std::vector<size_t>& Offsets)
+{
+	size_t Offset = 0;
+	for (; Offset + COMPARE_BLOCK_SIZE <= Size; Offset += COMPARE_BLOCK_SIZE)
+	{
+		__m128i Equal0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(Left + Offset)), _mm_loadu_si128((const __m128i*)(Right + Offset)));
+		__m128i Equal1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(Left + Offset + 16)), _mm_loadu_si128((const __m128i*)(Right + Offset + 16)));
+		__m128i Equal2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(Left + Offset + 32)), _mm_loadu_si128((const __m128i*)(Right + Offset + 32)));
+		__m128i Equal3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(Left + Offset + 48)), _mm_loadu_si128((const __m128i*)(Right + Offset + 48)));
+
+		//
+		// Skip the block with one movemask when all 64 bytes are equal
+		//
+
+		__m128i AllEqual = _mm_and_si128(_mm_and_si128(Equal0, Equal1), _mm_and_si128(Equal2, Equal3));
+		if (_mm_movemask_epi8(AllEqual) == 0xFFFF)
+		{
+			continue;
+		}
+
+		unsigned long long Mask = static_cast<unsigned long long>(static_cast<unsigned int>(_mm_movemask_epi8(Equal0))) |
+			static_cast<unsigned long long>(static_cast<unsigned int>(_mm_movemask_epi8(Equal1))) << 16 |
+			static_cast<unsigned long long>(static_cast<unsigned int>(_mm_movemask_epi8(Equal2))) << 32 |
+			static_cast<unsigned long long>(static_cast<unsigned int>(_mm_movemask_epi8(Equal3))) << 48;
+
+		EmitDifferences(~Mask, Offset, Offsets);
+	}
+
+	for (; Offset < Size; Offset++)
+	{
+		if (Left[Offset] != Right[Offset])
+		{
+			Offsets.push_back(Offset);
+		}
+	}
+}
+
+PLATFORM_TARGET("avx2")
+static void FindDifferencesAvx2(const unsigned char* Left, const unsigned char* Right, size_t Size, std::vector<size_t>& Offsets)
+{
+	size_t Offset = 0;
+	for (; Offset + COMPARE_BLOCK_SIZE <= Size; Offset += COMPARE_BLOCK_SIZE)
+	{
+		__m256i Equal0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(Left + Offset)), _mm256_loadu_si256((const __m256i*)(Right + Offset)));
+		__m256i Equal1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(Left + Offset + 32)), _mm256_loadu_si256((const __m256i*)(Right + Offset + 32)));
+
+		//
+		// Skip the block with one movemask when all 64 bytes are equal
+		//
+
+		if (static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_and_si256(Equal0, Equal1))) == 0xFFFFFFFF)
+		{
+			continue;
+		}
+
+		unsigned long long Mask = static_cast<unsigned long long>(static_cast<unsigned int>(_mm256_movemask_epi8(Equal0))) |
+			static_cast<unsigned long long>(static_cast<unsigned int>(_mm256_movemask_epi8(Equal1))) << 32;
+
+		EmitDifferences(~Mask, Offset, Offsets);
+	}
+
+	_mm256_zeroupper();
+
+	for (; Offset < Size; Offset++)
+	{
+		if (Left[Offset] != Right[Offset])
+		{
+			Offsets.push_back(Offset);
+		}
+	}
+}
+
+//
+// AVX2 requires the CPUID feature bit and the OS saving the YMM state (OSXSAVE and XCR0 bits 1 and 2)
+//
+
+static bool CompareSupportsAvx2()
+{
+	int CpuInfo[4] = { 0 };
+	PlatformCpuid(CpuInfo, 0);
+	if (CpuInfo[0] < 7)
+	{
+		return false;
+	}
+
+	PlatformCpuid(CpuInfo, 1);
+	bool OsXsave = (CpuInfo[2] & (1 << 27)) != 0;
+	bool Avx = (CpuInfo[2] & (1 << 28)) != 0;
+	if (!OsXsave || !Avx || (PlatformXgetbv(0) & 0x6) != 0x6)
+	{
+		return false;
+	}
+
+	PlatformCpuid(CpuInfo, 7, 0);
+	return (CpuInfo[1] & (1 << 5)) != 0;
+}
+
+#endif
+
+void InitializeCompareKernel(COMPARE_KERNEL Kernel)
+{
+#if defined(PLATFORM_X86)
+	bool Avx2 = CompareSupportsAvx2();
+
+	if (Kernel == CompareKernelAutomatic)
+	{
+		Kernel = Avx2 ? CompareKernelAvx2 : CompareKernelSse2;
+	}
+
+	if (Kernel == CompareKernelAvx2 && !Avx2)
+	{
+		Kernel = CompareKernelSse2;
+	}
+#else
+	Kernel = CompareKernelScalar;
+#endif
+
+	switch (Kernel)
+	{
+#if defined(PLATFORM_X86)
+	case CompareKernelSse2:
+		CompareRoutine = FindDifferencesSse2;
+		break;
+	case CompareKernelAvx2:
+		CompareRoutine = FindDifferencesAvx2;
+		break;
+#endif
+	default:
+		Kernel = CompareKernelScalar;
+		CompareRoutine = FindDifferencesScalar;
+		break;
+	}
+
+	CompareRoutineKernel = Kernel;
+}
+
+COMPARE_KERNEL SelectedCompareKernel()
+{
+	return CompareRoutineKernel;
+}
+
+void FindDifferences(const void* Left, const void* Right, size_t Size, std::vector<size_t>& Offsets)
+{
+	CompareRoutine(static_cast<const unsigned char*>(Left), static_cast<const unsigned char*>(Right), Size, Offsets);
+}
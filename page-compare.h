@@ -0,0 +1,67 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <vector>
+
+//
+// Deep compare kernels, all of them produce the same offsets
+// scalar - one byte per iteration, the original ComparePages loop
+// sse2 - 64 bytes per iteration as four 16-byte compares
+// avx2 - 64 bytes per iteration as two 32-byte compares
+// Identical 64-byte blocks are skipped with a single test, only the set bits of the difference bitmap are visited
+//
+
+typedef enum _COMPARE_KERNEL
+{
+	CompareKernelScalar,
+	CompareKernelSse2,
+	CompareKernelAvx2,
+	CompareKernelAutomatic
+} COMPARE_KERNEL;
+
+// queries CPUID and selects the kernel used by FindDifferences, called once at startup before any scanning thread runs
+void InitializeCompareKernel(COMPARE_KERNEL Kernel = CompareKernelAutomatic);
+COMPARE_KERNEL SelectedCompareKernel();
+
+/*++
+
+Routine Description:
+
+	Appends the offset of every byte that differs between Left and Right to Offsets, in ascending order
+
+Parameters:
+
+	Left - The first buffer, e.g. the page snapshot
+	Right - The second buffer, e.g. the page resident in module memory
+	Size - The size of both buffers
+	Offsets - Receives the offsets of the differing bytes
+
+Return Value:
+
+	None
+
+--*/
+void FindDifferences(const void* Left, const void* Right, size_t Size, std::vector<size_t>& Offsets);
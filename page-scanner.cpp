@@ -0,0 +1,73 @@
+#include "pch.h"
+#include "page-scanner.h"
+
+/*++
+
+Routine Description:
+
+	Compares the memory contents of the pages for where the changes occurred.
+	Called when EvaluatePage detects a checksum mismatch
+
+Parameters:
+
+	Page - the virtual address of the page's snapshot, used in comparing against Page
+	AltPage - The live contents of the page resident in the module's memory, used in comparison and iteration
+	Module - The module the page is in
+	Offset - The offset of the page from the module base
+	PageSize - The memory size of the pages to compare, indicates when to stop comparing
+	Tree - The checksum tree of the page's snapshot, used to narrow down the bytes to compare, NULL to compare the whole range
+	DirtyOffset - The start of the part of the page known to hold the changes, e.g. the sweep chunk that mismatched
+	DirtyLength - The length of that part, SIZE_MAX for the rest of the page
+	GapThreshold - Changes at most this many unchanged bytes apart are merged into one range
+
+Return Value:
+
+	DIFF_SET - The coalesced ranges of changes relative to the page, with both the original and the changed bytes of each range
+
+--*/
+DIFF_SET ComparePages(const void* Page, const void* AltPage, MODULE_ID Module, SIZE_T Offset, size_t PageSize, const CHECKSUM_TREE* Tree, SIZE_T DirtyOffset, SIZE_T DirtyLength,
+	SIZE_T GapThreshold)
+{
+	const BYTE* PageBytes = static_cast<const BYTE*>(Page);
+	const BYTE* AltPageBytes = static_cast<const BYTE*>(AltPage);
+
+	//
+	// Descend the checksum tree from the dirty part of the page to find the dirty leaves, only those are read from the snapshot and byte compared
+	// If there is no tree, or it does not localize the change (a sub-block checksum collision), compare the whole dirty part
+	//
+
+	DirtyOffset = (std::min)(DirtyOffset, static_cast<SIZE_T>(PageSize));
+	DirtyLength = (std::min)(DirtyLength, PageSize - DirtyOffset);
+
+	std::vector<CHECKSUM_TREE_SPAN> Spans;
+	if (Tree)
+	{
+		FindDirtySpans(*Tree, AltPageBytes, PageSize, DirtyOffset, DirtyLength, Spans);
+	}
+
+	if (Spans.empty())
+	{
+		Spans.push_back({ DirtyOffset, DirtyLength });
+	}
+
+	//
+	// Compare the page in original memory and the alternate saved page with the SIMD kernel, which only reports the differing offsets
+	// Then merge the offsets into ranges of changes
+	//
+
+	std::vector<size_t> Differences;
+	for (const CHECKSUM_TREE_SPAN& Span : Spans)
+	{
+		size_t First = Differences.size();
+		FindDifferences(PageBytes + Span.Offset, AltPageBytes + Span.Offset, Span.Length, Differences);
+		for (size_t Index = First; Index < Differences.size(); Index++)
+		{
+			Differences[Index] += Span.Offset;
+		}
+	}
+
+	DIFF_SET Diff;
+	CoalesceDifferences(Diff, Module, Offset, PageBytes, AltPageBytes, Differences, GapThreshold);
+
+	return Diff;
+}
@@ -0,0 +1,1381 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "platform.h"
+#include "diff-range.h"
+#include "dirty-pages.h"
+#include "change-queue.h"
+#include "checksum-tree.h"
+#include "error-checking.h"
+#include "governor.h"
+#include "hash-policy.h"
+#include "macrowriter.h"
+#include "page-compare.h"
+#include "page-table.h"
+#include "process-memory.h"
+#include "regions.h"
+#include "snapshot-arena.h"
+#include "worker-pool.h"
+#include "write-monitor.h"
+
+//
+// The hash policy the scanner thread is instantiated over (Crc32Policy, Xxh3Policy or Hash128Policy, see hash-policy.h)
+// A full sweep checksums the rows up to ScanSweepChunk bytes with it, larger rows and the dirty or trapped pages are always checked
+// through their CRC32 checksum trees
+//
+
+typedef Crc32Policy ScanHashPolicy;
+
+//
+// Keep the 64-byte cache line level of the checksum trees, localizes changes further at 4x the tree memory
+//
+
+const bool ScanTreeCacheLines = false;
+
+//
+// Only re-check the pages the OS reports written since the last sweep (see dirty-pages.h), when it can track them
+// Every ScanVerifyInterval sweeps a full checksum sweep runs instead, catching anything the dirty tracking missed
+//
+
+const bool ScanDirtyTracking = true;
+const size_t ScanVerifyInterval = 64;
+
+//
+// Prompt the console for the name of each generated macro, otherwise they are named Change<N> (see change-queue.h)
+// Either way the prompt and the output run on the change queue's consumer thread, never on a scanning thread
+//
+
+const bool ScanPromptMacroNames = false;
+
+//
+// Also write each change as a binary patch file into ScanPatchDirectory (see patch-file.h), empty to only output the macros
+// A patch is replayed with ApplyPatchFile (see patch-applier.h) instead of compiling the macro, and reverted the same way
+//
+
+const char ScanPatchDirectory[] = "";
+
+//
+// Changes at most ScanMacroGapThreshold unchanged bytes apart are reported as one range, so the generated macro writes them
+// with one WriteProcessMemory, rewriting the unchanged bytes between them, rather than one per run
+//
+
+const SIZE_T ScanMacroGapThreshold = 32;
+
+//
+// Register the module's writeable regions (its data) instead of its PAGE_EXECUTE_READ and PAGE_READONLY ones
+// Off by default: the module writes its own data, so every such write is reported. Set it to watch the data of a module
+// that should not change after startup, it is the registration the WriteMonitorTrap engine needs
+//
+
+const bool ScanWriteableRegions = false;
+
+//
+// Wait for writes to the pages instead of sweeping them, falls back to sweeping when the write monitor cannot start
+// Off by default: userfaultfd only write protects anonymous, shmem and hugetlb memory, a module image is file-backed
+// so registering it fails with EINVAL. Set it for modules whose registered regions are anonymous (e.g. unpacked at runtime)
+// WriteMonitorTrap only observes writeable regions, a read-only page cannot be trapped by revoking write, so it starts only
+// for the ScanWriteableRegions registration and the scanner sweeps the default (read-only) registration instead
+// A written page is diffed ScanFaultSettle after the write, giving the writer time to finish
+//
+
+const bool ScanWriteFaults = false;
+const WRITE_MONITOR_ENGINE ScanWriteEngine = WriteMonitorUserfaultfd;
+const std::chrono::milliseconds ScanFaultSettle(10);
+
+//
+// Out-of-process, the most bytes of consecutive pages read with one batched read while sweeping
+//
+
+const SIZE_T ScanReadWindow = 8 * 1024 * 1024;
+
+//
+// Full sweeps are split into chunks of about ScanSweepChunk bytes, run on a work-stealing pool of ScanThreadCount workers
+// (0 for one per hardware thread), pinned to a logical processor each when ScanPinThreads is set
+// Pinning is off by default, a pinned worker cannot move off a core the target process or another monitor is busy on
+// The scan daemon sweeps its targets on its own workers instead
+//
+
+const SIZE_T ScanSweepChunk = 256 * 1024;
+const size_t ScanThreadCount = 0;
+const bool ScanPinThreads = false;
+
+//
+// Pace the sweep loop to at most ScanCpuBudget of one core and a sweep every ScanSweepPeriod (see governor.h), 0 lifts either limit
+// The governor reports the achieved period and detection latency, lengthen the period to lower the overhead, shorten it to detect sooner
+//
+
+const double ScanCpuBudget = 0.05;
+const std::chrono::milliseconds ScanSweepPeriod(200);
+
+//
+// Adaptive full sweeps: a page that changed within the last ScanHotSweeps full sweeps is checked on every full sweep, a stable page
+// is checked on an exponentially backed-off cadence, its interval doubling with each check up to ScanColdMaxInterval full sweeps
+// ScanColdMaxInterval bounds how stale the check of any page gets, ScanColdMaxInterval sweep periods, and with dirty tracking
+// ScanColdMaxInterval * ScanVerifyInterval sweep periods for a write the tracking missed, since only every ScanVerifyInterval-th sweep is full
+//
+
+const bool ScanAdaptive = true;
+const size_t ScanHotSweeps = 8;
+const size_t ScanColdMaxInterval = 16;
+
+/*++
+
+Routine Description:
+
+	Retrieves the checksum of the data provided, being the start address and iterates for the range provided
+	The hash is the policy's, inlined into the caller
+
+Parameters:
+
+	Start - The start address to for the checksum
+	End - How many iterations after the start address
+
+Return Value:
+
+	HashPolicy::Checksum - Returns the checksum (Checksum)
+
+--*/
+template <class HashPolicy>
+typename HashPolicy::Checksum GetChecksum(void* Start, std::size_t End)
+{
+	return HashPolicy::Compute(Start, End);
+}
+
+/*++
+
+Routine Description:
+
+	Registers a page in the page table (the list of pages and their checksums to be validated)
+	Only allocates the snapshot storage from the arena, the contents are captured in bulk by CaptureSnapshots
+
+Parameters:
+	
+	DiffList - The page table the page is registered in, its arena must have room for the page
+	BasicInformation - The basic memory information of the page being registered, such as the base address and page size
+
+Return Value:
+
+	bool - false if the arena is exhausted
+
+--*/
+template <class HashPolicy>
+bool EstablishPage(PAGE_TABLE<HashPolicy>& DiffList, const MEM_REGION& BasicInformation)
+{
+	BYTE* PageData = AllocateSnapshot(DiffList.Arena, BasicInformation.RegionSize);
+	if (!PageData)
+	{
+		return false;
+	}
+
+	DiffList.Bases.push_back(BasicInformation.BaseAddress);
+	DiffList.Sizes.push_back(BasicInformation.RegionSize);
+	DiffList.Checksums.push_back(typename HashPolicy::Checksum());
+	DiffList.Protections.push_back(BasicInformation.Protect);
+	DiffList.Snapshots.push_back(PageData);
+	DiffList.Trees.push_back(CHECKSUM_TREE());
+	return true;
+}
+
+/*++
+
+Routine Description:
+
+	Captures the snapshots and checksums of the registered pages starting at First in the DiffList
+	Regions are split into fixed-size chunks copied with memcpy across the worker pool, so one large
+	.text region is captured by every worker rather than a single one. Checksums and checksum trees are then built per region, also in parallel
+	Out-of-process each worker reads a batch of chunks with one batched read (see process-memory.h)
+
+Parameters:
+
+	DiffList - The page table, with the pages from First on registered by EstablishPage
+	First - The index of the first page in the page table to capture
+	Memory - The memory of the process the pages are in
+
+Return Value:
+
+	DWORD - 0 or the error of a read that failed, the pages are captured regardless (partially when a read failed)
+
+--*/
+template <class HashPolicy>
+DWORD CaptureSnapshots(PAGE_TABLE<HashPolicy>& DiffList, size_t First, PROCESS_MEMORY& Memory)
+{
+	const size_t ChunkSize = 1024 * 1024;
+	const size_t ReadBatch = 64;
+
+	struct CAPTURE_CHUNK
+	{
+		size_t Page;
+		size_t Offset;
+		size_t Size;
+	};
+
+	std::vector<CAPTURE_CHUNK> Chunks;
+	for (size_t Page = First; Page < DiffList.Count(); Page++)
+	{
+		for (size_t Offset = 0; Offset < DiffList.Sizes[Page]; Offset += ChunkSize)
+		{
+			Chunks.push_back({ Page, Offset, (std::min)(ChunkSize, DiffList.Sizes[Page] - Offset) });
+		}
+	}
+
+	const size_t ChunksPerRead = IsLocalProcess(Memory) ? 1 : ReadBatch;
+	std::atomic<DWORD> CaptureStatus(0);
+
+	ParallelFor((Chunks.size() + ChunksPerRead - 1) / ChunksPerRead, [&](size_t BatchIndex)
+	{
+		PROCESS_READ Reads[ReadBatch];
+		size_t Count = 0;
+		for (size_t ChunkIndex = BatchIndex * ChunksPerRead; ChunkIndex < Chunks.size() && Count < ChunksPerRead; ChunkIndex++, Count++)
+		{
+			const CAPTURE_CHUNK& Chunk = Chunks[ChunkIndex];
+			Reads[Count] = { static_cast<BYTE*>(DiffList.Bases[Chunk.Page]) + Chunk.Offset, DiffList.Snapshots[Chunk.Page] + Chunk.Offset, Chunk.Size };
+		}
+
+		DWORD StatusCode = ReadProcessRanges(Memory, Reads, Count);
+		if (StatusCode)
+		{
+			CaptureStatus.store(StatusCode);
+		}
+	});
+
+	ParallelFor(DiffList.Count() - First, [&](size_t PageIndex)
+	{
+		size_t Page = First + PageIndex;
+		DiffList.Checksums[Page] = GetChecksum<HashPolicy>(DiffList.Snapshots[Page], DiffList.Sizes[Page]);
+		BuildChecksumTree(DiffList.Trees[Page], DiffList.Snapshots[Page], DiffList.Sizes[Page], ScanTreeCacheLines);
+	});
+
+	return CaptureStatus.load();
+}
+
+/*++
+
+Routine Description:
+	
+	Retrieves and iterates over each page in the process, registering only the ones that
+	are either PAGE_EXECUTE_READ or PAGE_READONLY, or only the writeable ones with ScanWriteableRegions.
+	Registering writeable pages is not recommended, because it is intended behavior for those pages to be written to.
+	It is not typical for READONLY/EXECUTE_READ pages to be modified.
+
+Paremeters:
+
+	Memory - The memory of the process the module is loaded in
+	ModuleName - The name of the module in the process to use for page list registration, empty for the main executable
+	DiffList - The page table of pages which will be checked against after registering all pages in the module, its arena is created here
+
+Return Value:
+
+	DWORD - 0 or GetLastError() indicating a WINAPI error (errno on Linux)
+
+--*/
+template <class HashPolicy>
+DWORD GetModulePages(PROCESS_MEMORY& Memory, LPWSTR ModuleName, PAGE_TABLE<HashPolicy>& DiffList)
+{
+	//
+	// Collect the pages to register first, so the arena and the page table are sized once and never move while being captured
+	// The regions come from the platform's enumerator (VirtualQueryEx walk on Windows, /proc/<pid>/maps on Linux), see regions.h
+	//
+
+	REGION_ENUMERATOR Enumerator;
+	std::vector<MEM_REGION> Registered;
+	PVOID ModuleBase = NULL;
+
+	DWORD EnumerateStatus = EnumerateModuleRegions(Enumerator, Memory.ProcessId, ModuleName, ModuleBase, Registered,
+		ScanWriteableRegions ? RegionsWriteable : RegionsProtected);
+	if (EnumerateStatus)
+	{
+		std::cerr << "EnumerateModuleRegions encountered an error: " << EnumerateStatus << std::endl;
+		return EnumerateStatus;
+	}
+
+	std::cout << "Module EP: " << ModuleBase << std::endl;
+
+	//
+	// Module ids are only meaningful in this process, a change leaves it keyed by the module's name (see module-table.h),
+	// so the main executable is registered under its own name, an empty name would apply to whatever executable a target runs
+	//
+
+	std::wstring RegisteredName = ModuleName ? ModuleName : L"";
+	if (RegisteredName.empty() && QueryExecutableName(Memory.ProcessId, RegisteredName))
+	{
+		RegisteredName.clear();
+	}
+	DiffList.Module = RegisterModule(RegisteredName.c_str());
+	DiffList.ModuleBase = ModuleBase;
+
+	//
+	// Create the snapshot arena (large page backed when permitted) for every snapshot of the module
+	//
+
+	if (!DiffList.Arena.Base)
+	{
+		SIZE_T ArenaSize = 0;
+		for (const MEM_REGION& Page : Registered)
+		{
+			ArenaSize += Page.RegionSize;
+		}
+
+		DWORD StatusCode = CreateSnapshotArena(DiffList.Arena, ArenaSize, true);
+		if (StatusCode)
+		{
+			std::cerr << "CreateSnapshotArena encountered an error: " << StatusCode << std::endl;
+			return StatusCode;
+		}
+	}
+
+	//
+	// Register the pages, then save all of their data and register their checksums in bulk
+	//
+
+	size_t First = DiffList.Count();
+	DiffList.Reserve(First + Registered.size());
+	for (const MEM_REGION& Page : Registered)
+	{
+		if (!EstablishPage(DiffList, Page))
+		{
+			std::cerr << "Snapshot arena exhausted at page: " << Page.BaseAddress << std::endl;
+			return ERROR_NOT_ENOUGH_MEMORY;
+		}
+	}
+
+	DWORD CaptureStatus = CaptureSnapshots(DiffList, First, Memory);
+	if (CaptureStatus)
+	{
+		std::cerr << "CaptureSnapshots encountered an error: " << CaptureStatus << std::endl;
+	}
+
+	for (size_t Page = First; Page < DiffList.Count(); Page++)
+	{
+		std::cout << "Added Page Base: " << DiffList.Bases[Page] << "\n";
+		std::cout << "Page Checksum: " << std::hex << DiffList.Checksums[Page] << "\n";
+	}
+	std::cout << std::dec << std::flush;
+
+	return 0;
+}
+
+
+/*++
+
+Routine Description:
+	
+	EvaluatePage is used for verifying that a page is maintaining its data integrity.
+	If the page data is not intact, a checksum mismatch is generated
+
+Parameters:
+
+	Comparator - A view of the page table row which contains the page resident in module memory (its live contents), as well as a snapshot of that page
+	TargetChecksum - Receives the checksum of the page resident in module memory
+
+Return Value:
+
+	bool - true on a checksum mismatch, TargetChecksum holds the unexpected/invalid checksum
+
+--*/
+template <class HashPolicy>
+bool EvaluatePage(const MEM_DIFF_VIEW<HashPolicy>& Comparator, typename HashPolicy::Checksum& TargetChecksum)
+{
+	//
+	// Calculate the checksum of the page the same way as the one on record (e.g. same CRC polynomial) and compare them
+	//
+
+	TargetChecksum = HashPolicy::Recompute(Comparator.LiveData, Comparator.RegionSize, *Comparator.Checksum);
+	if (TargetChecksum != *Comparator.Checksum)
+	{
+		//
+		// Checksum mismatch
+		//
+
+		return true;
+	}
+	return false;
+}
+
+/*++
+
+Routine Description:
+
+	Compares the memory contents of the pages for where the changes occurred.
+	Called when EvaluatePage detects a checksum mismatch
+
+Parameters:
+
+	Page - the virtual address of the page's snapshot, used in comparing against Page
+	AltPage - The live contents of the page resident in the module's memory, used in comparison and iteration
+	Module - The module the page is in
+	Offset - The offset of the page from the module base
+	PageSize - The memory size of the pages to compare, indicates when to stop comparing
+	Tree - The checksum tree of the page's snapshot, used to narrow down the bytes to compare, NULL to compare the whole range
+	DirtyOffset - The start of the part of the page known to hold the changes, e.g. the sweep chunk that mismatched
+	DirtyLength - The length of that part, SIZE_MAX for the rest of the page
+	GapThreshold - Changes at most this many unchanged bytes apart are merged into one range
+
+Return Value:
+
+	DIFF_SET - The coalesced ranges of changes relative to the page, with both the original and the changed bytes of each range
+
+--*/
+DIFF_SET ComparePages(const void* Page, const void* AltPage, MODULE_ID Module, SIZE_T Offset, size_t PageSize, const CHECKSUM_TREE* Tree, SIZE_T DirtyOffset = 0,
+	SIZE_T DirtyLength = SIZE_MAX, SIZE_T GapThreshold = DIFF_DEFAULT_GAP_THRESHOLD);
+
+/*++
+
+Routine Description:
+
+	Accepts the changes of a page into its snapshot, after they were reported
+	The changed bytes of each range are written into the snapshot and only the checksum tree nodes covering them are recomputed,
+	then the page checksum is recomputed from the snapshot
+
+Parameters:
+
+	DiffList - The page table the page is registered in
+	Index - The index of the page in the page table
+	Diff - The changes of the page, as returned by ComparePages
+
+Return Value:
+
+	None
+
+--*/
+template <class HashPolicy>
+void AcceptPageChanges(PAGE_TABLE<HashPolicy>& DiffList, size_t Index, const DIFF_SET& Diff)
+{
+	BYTE* Snapshot = DiffList.Snapshots[Index];
+	SIZE_T RegionSize = DiffList.Sizes[Index];
+
+	for (const DIFF_RANGE& Range : Diff.Ranges)
+	{
+		memcpy(Snapshot + Range.Offset, DiffRangeBytes(Diff, Range, DiffApply), Range.Length);
+		UpdateChecksumTree(DiffList.Trees[Index], Snapshot, RegionSize, Range.Offset, Range.Length);
+	}
+
+	DiffList.Checksums[Index] = GetChecksum<HashPolicy>(Snapshot, RegionSize);
+}
+
+/*++
+
+Routine Description:
+
+	Reports a page whose checksum mismatched: diffs it and posts the changes to the change queue (see change-queue.h),
+	which outputs them and generates the macro and its undo on its own thread, then accepts the changes
+	Never waits on the console. When the change queue is full the changes are not accepted, so the page is reported again later
+
+Parameters:
+
+	PageSet - The page table the page is registered in
+	ProcessId - The process the page is in, 0 for the current process
+	PageIndex - The index of the page in the page table
+	Live - The live contents of the page
+	Checksum - The mismatching checksum of the page resident in module memory
+	DirtyOffset - The start of the part of the page the mismatch was found in, only that part is diffed
+	DirtyLength - The length of that part
+
+Return Value:
+
+	bool - false when the change queue was full and the changes were left out of the snapshot
+
+--*/
+template <class HashPolicy>
+bool ReportPageChange(PAGE_TABLE<HashPolicy>& PageSet, DWORD ProcessId, size_t PageIndex, const BYTE* Live, const typename HashPolicy::Checksum& Checksum,
+	SIZE_T DirtyOffset, SIZE_T DirtyLength)
+{
+	CHANGE_EVENT Event;
+	Event.ProcessId = ProcessId;
+	Event.BaseAddress = PageSet.Bases[PageIndex];
+	Event.ModuleBase = PageSet.ModuleBase;
+
+	std::ostringstream Formatted;
+	Formatted << Checksum;
+	Event.ChangedChecksum = Formatted.str();
+	Formatted.str("");
+	Formatted << PageSet.Checksums[PageIndex];
+	Event.ExpectedChecksum = Formatted.str();
+
+	//
+	// Compare and extract the changed memory with their corresponding addresses indicating where the pages differ
+	// The event takes the changes, a copy is kept to accept them once the event is posted
+	//
+
+	SIZE_T Offset = static_cast<BYTE*>(Event.BaseAddress) - static_cast<BYTE*>(PageSet.ModuleBase);
+	Event.Diff = ComparePages(PageSet.Snapshots[PageIndex], Live, PageSet.Module, Offset, PageSet.Sizes[PageIndex], &PageSet.Trees[PageIndex], DirtyOffset, DirtyLength,
+		ScanMacroGapThreshold);
+	DIFF_SET ChangedData = Event.Diff;
+
+	if (!PostChangeEvent(Event))
+	{
+		return false;
+	}
+
+	//
+	// Accept the change into the snapshot, so the page is only reported again once it changes further
+	//
+
+	AcceptPageChanges(PageSet, PageIndex, ChangedData);
+	return true;
+}
+
+//
+// Outcome of a slice of a sweep, see SweepPageSlice
+//
+
+typedef enum _SWEEP_RESULT
+{
+	SweepPending,
+	SweepComplete,
+	SweepExited
+} SWEEP_RESULT;
+
+//
+// A chunk of a full sweep: the whole rows [Begin, End) when Length is 0, otherwise [Offset, Offset + Length) of row Begin,
+// with Offset a multiple of TREE_PAGE_SIZE so the chunk is checked against the page level of the row's checksum tree
+//
+
+typedef struct _SWEEP_CHUNK
+{
+	size_t Begin;
+	size_t End;
+	SIZE_T Offset;
+	SIZE_T Length;
+} SWEEP_CHUNK;
+
+//
+// A row that mismatched in a full sweep, with the part of it checked by the chunk that found it
+//
+
+typedef struct _SWEEP_MISMATCH
+{
+	size_t PageIndex;
+	SIZE_T Offset;
+	SIZE_T Length;
+} SWEEP_MISMATCH;
+
+inline bool operator<(const SWEEP_MISMATCH& Left, const SWEEP_MISMATCH& Right)
+{
+	return Left.PageIndex < Right.PageIndex || (Left.PageIndex == Right.PageIndex && Left.Offset < Right.Offset);
+}
+
+//
+// The change statistics of a row, by full sweep number: when it is next due, its current interval, and its changes
+//
+
+typedef struct _SWEEP_ROW
+{
+	size_t NextSweep;
+	size_t Interval;
+	size_t LastChange;
+	size_t Changes;
+} SWEEP_ROW;
+
+//
+// Sweep State
+// What a sweep of one page table keeps between slices: the dirty tracker of its process, how far the current full sweep got,
+// and the buffers of its reads and chunks, reused from sweep to sweep so a steady-state sweep does not allocate
+//
+
+typedef struct _SWEEP_STATE
+{
+	WORKER_POOL* Pool;
+	DIRTY_TRACKER Tracker;
+	bool TrackDirty;
+	size_t Sweep;
+	size_t FullSweeps;
+	size_t Cursor;
+	size_t SliceThreads;
+	bool Unreadable;
+	std::vector<SWEEP_ROW> Rows;
+	std::vector<std::pair<size_t, SIZE_T>> DirtyPages;
+	std::vector<SIZE_T> DirtyOffsets;
+	std::vector<PROCESS_READ> DirtyReads;
+	std::vector<BYTE> DirtyStaging;
+	LIVE_WINDOW Window;
+	LIVE_WINDOW RegionWindow;
+	std::vector<SWEEP_CHUNK> Chunks;
+	RESULT_QUEUE<SWEEP_MISMATCH> Mismatches;
+} SWEEP_STATE;
+
+/*++
+
+Routine Description:
+
+	Prepares the state of a sweep, opening the dirty page tracker of the process when ScanDirtyTracking is set
+	Without it every sweep is a full checksum sweep
+
+Parameters:
+
+	State - Receives the state of the sweep
+	Memory - The memory of the process the pages are in
+	Pool - The worker pool full sweeps are run on, NULL to run them on the sweeping thread
+
+Return Value:
+
+	None
+
+--*/
+inline void OpenSweepState(SWEEP_STATE& State, PROCESS_MEMORY& Memory, WORKER_POOL* Pool = NULL)
+{
+	State.Pool = Pool;
+	State.Tracker = {};
+	State.TrackDirty = false;
+	State.Sweep = 0;
+	State.FullSweeps = 0;
+	State.Cursor = SIZE_MAX;
+	State.SliceThreads = 1;
+	State.Unreadable = false;
+	State.Rows.clear();
+
+	if (ScanDirtyTracking)
+	{
+		DWORD StatusCode = OpenDirtyTracker(State.Tracker, Memory.ProcessId);
+		State.TrackDirty = !StatusCode;
+		if (State.TrackDirty)
+		{
+			std::cout << "Dirty page tracking enabled" << std::endl;
+		}
+		else
+		{
+			std::cout << "Dirty page tracking unavailable (" << StatusCode << "), using full sweeps" << std::endl;
+		}
+	}
+}
+
+inline void CloseSweepState(SWEEP_STATE& State)
+{
+	if (State.TrackDirty)
+	{
+		CloseDirtyTracker(State.Tracker);
+	}
+	State.TrackDirty = false;
+}
+
+// whether a row is checked by the current full sweep, every row is without ScanAdaptive
+inline bool IsRowDue(const SWEEP_STATE& State, size_t PageIndex)
+{
+	return !ScanAdaptive || PageIndex >= State.Rows.size() || State.Rows[PageIndex].NextSweep <= State.FullSweeps;
+}
+
+/*++
+
+Routine Description:
+
+	Schedules the next check of a row by the full sweeps, after it was checked
+	A row that changed recently stays due on every full sweep, a stable one has its interval doubled up to ScanColdMaxInterval.
+	A row reaching that interval is first due at a phase set by its index, so the cold rows are spread over the full sweeps
+	rather than all falling due on the same one
+
+Parameters:
+
+	State - The state of the sweep
+	PageIndex - The index of the row
+	Changed - true when the row changed
+
+Return Value:
+
+	None
+
+--*/
+inline void ScheduleRow(SWEEP_STATE& State, size_t PageIndex, bool Changed)
+{
+	if (PageIndex >= State.Rows.size())
+	{
+		return;
+	}
+
+	SWEEP_ROW& Row = State.Rows[PageIndex];
+	if (Changed)
+	{
+		Row.Changes++;
+		Row.LastChange = State.FullSweeps;
+	}
+
+	if (Row.Changes && State.FullSweeps - Row.LastChange < ScanHotSweeps)
+	{
+		Row.Interval = 1;
+		Row.NextSweep = State.FullSweeps + 1;
+		return;
+	}
+
+	if (Row.Interval < ScanColdMaxInterval)
+	{
+		Row.Interval = (std::min)(Row.Interval * 2, ScanColdMaxInterval);
+		Row.NextSweep = State.FullSweeps + (Row.Interval < ScanColdMaxInterval ? Row.Interval : 1 + PageIndex % ScanColdMaxInterval);
+		return;
+	}
+	Row.NextSweep = State.FullSweeps + Row.Interval;
+}
+
+/*++
+
+Routine Description:
+
+	Splits the rows [First, Last) of a live window into chunks balanced by bytes rather than rows, row sizes range from one page
+	to tens of MiB: consecutive rows are grouped up to ScanSweepChunk bytes, a larger row is split into ScanSweepChunk pieces
+
+Parameters:
+
+	PageSet - The page table
+	State - The state of the sweep, receives the chunks in State.Chunks
+	First - The index of the first row of the window
+	Last - The index after the last row of the window
+
+Return Value:
+
+	None
+
+--*/
+template <class HashPolicy>
+void BuildSweepChunks(const PAGE_TABLE<HashPolicy>& PageSet, SWEEP_STATE& State, size_t First, size_t Last)
+{
+	State.Chunks.clear();
+	SIZE_T GroupBytes = 0;
+
+	for (size_t PageIndex = First; PageIndex < Last; PageIndex++)
+	{
+		//
+		// Rows left out of the window (not due, or unreadable) are not chunked
+		//
+
+		if (!State.Window.Live[PageIndex - First])
+		{
+			continue;
+		}
+
+		SIZE_T RegionSize = PageSet.Sizes[PageIndex];
+		if (RegionSize > ScanSweepChunk)
+		{
+			for (SIZE_T Offset = 0; Offset < RegionSize; Offset += ScanSweepChunk)
+			{
+				State.Chunks.push_back({ PageIndex, PageIndex + 1, Offset, (std::min)(ScanSweepChunk, RegionSize - Offset) });
+			}
+			GroupBytes = 0;
+			continue;
+		}
+
+		if (GroupBytes == 0)
+		{
+			State.Chunks.push_back({ PageIndex, PageIndex, 0, 0 });
+		}
+		State.Chunks.back().End = PageIndex + 1;
+
+		GroupBytes += RegionSize;
+		if (GroupBytes >= ScanSweepChunk)
+		{
+			GroupBytes = 0;
+		}
+	}
+}
+
+/*++
+
+Routine Description:
+
+	Checks one chunk of a full sweep against the snapshots, pushing the rows that mismatch to State.Mismatches
+	Safe to run concurrently for different chunks, it only reads the page table and the live window
+
+Parameters:
+
+	PageSet - The page table
+	State - The state of the sweep, with the live window of the chunk
+	First - The index of the first row of the live window
+	Chunk - The chunk to check
+
+Return Value:
+
+	None
+
+--*/
+template <class HashPolicy>
+void SweepChunk(const PAGE_TABLE<HashPolicy>& PageSet, SWEEP_STATE& State, size_t First, const SWEEP_CHUNK& Chunk)
+{
+	if (Chunk.Length)
+	{
+		const BYTE* Live = State.Window.Live[Chunk.Begin - First];
+		if (Live && !RangeMatchesTree(PageSet.Trees[Chunk.Begin], Live + Chunk.Offset, PageSet.Sizes[Chunk.Begin], Chunk.Offset, Chunk.Length))
+		{
+			State.Mismatches.Push({ Chunk.Begin, Chunk.Offset, Chunk.Length });
+		}
+		return;
+	}
+
+	for (size_t PageIndex = Chunk.Begin; PageIndex < Chunk.End; PageIndex++)
+	{
+		//
+		// Evaluate through a non-owning view of the page table row, a steady-state sweep (no mismatches) does not allocate
+		// Prefetch a page a few rows ahead so its first lines are in flight while this one is hashed. The prefetches are written here
+		// rather than in a helper, GCC drops a call to an inline function that only prefetches as having no effect
+		// A row that could not be read has a NULL live pointer, prefetching it is harmless
+		//
+
+		const BYTE* Live = State.Window.Live[PageIndex - First];
+		if (!Live)
+		{
+			continue;
+		}
+
+		size_t Ahead = PageIndex - First + PAGE_PREFETCH_DISTANCE;
+		if (Ahead < State.Window.Live.size())
+		{
+			for (size_t Line = 0; Line < PAGE_PREFETCH_LINES; Line++)
+			{
+				PAGE_TABLE_PREFETCH(reinterpret_cast<const char*>(State.Window.Live[Ahead]) + Line * PAGE_PREFETCH_LINE_SIZE);
+			}
+		}
+		typename HashPolicy::Checksum Checksum;
+		if (EvaluatePage(ViewPage(PageSet, PageIndex, Live), Checksum))
+		{
+			State.Mismatches.Push({ PageIndex, 0, PageSet.Sizes[PageIndex] });
+		}
+	}
+}
+
+//
+// What the worker pool passes SweepChunkRoutine for the chunks of one live window
+//
+
+template <class HashPolicy>
+struct SWEEP_CHUNK_CONTEXT
+{
+	const PAGE_TABLE<HashPolicy>* PageSet;
+	SWEEP_STATE* State;
+	size_t First;
+};
+
+template <class HashPolicy>
+void SweepChunkRoutine(void* Context, size_t ChunkIndex)
+{
+	SWEEP_CHUNK_CONTEXT<HashPolicy>& Chunks = *static_cast<SWEEP_CHUNK_CONTEXT<HashPolicy>*>(Context);
+	SweepChunk(*Chunks.PageSet, *Chunks.State, Chunks.First, Chunks.State->Chunks[ChunkIndex]);
+}
+
+/*++
+
+Routine Description:
+
+	Runs a slice of a sweep of the page table, comparing the checksum of each page with its snapshot
+	A full sweep is spread over as many slices as Budget requires, resuming where the previous slice stopped
+	With dirty page tracking, most sweeps only check the pages the OS reports written, with a full sweep every ScanVerifyInterval sweeps,
+	a dirty sweep always runs in one slice
+
+Parameters:
+
+	PageSet - The page table, with every page captured
+	Memory - The memory of the process the pages are in
+	State - The state of the sweep, opened by OpenSweepState, its SliceThreads receives the number of threads the slice ran on
+	Budget - The bytes the slice may hash, at least one page is hashed so it overshoots by at most one page
+	Hashed - Receives the bytes the slice hashed
+
+Return Value:
+
+	SWEEP_RESULT - SweepComplete when a sweep finished in this slice, SweepExited when the process exited, otherwise SweepPending
+
+--*/
+template <class HashPolicy>
+SWEEP_RESULT SweepPageSlice(PAGE_TABLE<HashPolicy>& PageSet, PROCESS_MEMORY& Memory, SWEEP_STATE& State, SIZE_T Budget, SIZE_T& Hashed)
+{
+	Hashed = 0;
+	State.SliceThreads = 1;
+
+	if (State.Cursor == SIZE_MAX && (!State.TrackDirty || State.Sweep++ % ScanVerifyInterval == 0))
+	{
+		//
+		// Start a full sweep, the dirty bits are reset first so writes made during the sweep are seen by the next dirty sweep
+		//
+
+		State.Cursor = 0;
+		State.FullSweeps++;
+		State.Rows.resize(PageSet.Count(), { 0, 1, 0, 0 });
+		if (State.TrackDirty)
+		{
+			//
+			// The reset forgets the writes made since the last dirty sweep, so a row that is not due but was written
+			// (or whose dirty pages cannot be queried) is made due, otherwise its write would wait for the row's next turn
+			//
+
+			for (size_t PageIndex = 0; ScanAdaptive && PageIndex < PageSet.Count(); PageIndex++)
+			{
+				if (IsRowDue(State, PageIndex))
+				{
+					continue;
+				}
+
+				State.DirtyOffsets.clear();
+				if (FindDirtyPages(State.Tracker, PageSet.Bases[PageIndex], PageSet.Sizes[PageIndex], State.DirtyOffsets) || !State.DirtyOffsets.empty())
+				{
+					State.Rows[PageIndex].NextSweep = State.FullSweeps;
+				}
+			}
+			ResetDirtyPages(State.Tracker);
+		}
+	}
+
+	if (State.Cursor != SIZE_MAX)
+	{
+		while (State.Cursor < PageSet.Count())
+		{
+			//
+			// In-process the window only bounds the slice, out-of-process it is read in batches of up to ScanReadWindow bytes
+			//
+
+			size_t First = State.Cursor;
+			SIZE_T WindowSize = IsLocalProcess(Memory) ? Budget - Hashed : (std::min)(ScanReadWindow, Budget - Hashed);
+			size_t Last = ReadLiveWindow(Memory, PageSet, First, WindowSize, State.Window, [&](size_t PageIndex) { return IsRowDue(State, PageIndex); });
+			for (size_t PageIndex = First; PageIndex < Last; PageIndex++)
+			{
+				if (IsRowDue(State, PageIndex))
+				{
+					Hashed += PageSet.Sizes[PageIndex];
+					State.Unreadable |= !State.Window.Live[PageIndex - First];
+					ScheduleRow(State, PageIndex, false);
+				}
+			}
+
+			//
+			// Check the chunks of the window on the worker pool, a row mismatches at most once per chunk
+			//
+
+			BuildSweepChunks(PageSet, State, First, Last);
+			State.Mismatches.Reset(State.Chunks.size() + (Last - First));
+
+			SWEEP_CHUNK_CONTEXT<HashPolicy> Context = { &PageSet, &State, First };
+			if (State.Pool)
+			{
+				State.SliceThreads = (std::max)(State.SliceThreads, RunWorkerPool(*State.Pool, State.Chunks.size(), SweepChunkRoutine<HashPolicy>, &Context));
+			}
+			else
+			{
+				for (size_t ChunkIndex = 0; ChunkIndex < State.Chunks.size(); ChunkIndex++)
+				{
+					SweepChunkRoutine<HashPolicy>(&Context, ChunkIndex);
+				}
+			}
+
+			//
+			// Diff the mismatching rows in order on this thread. If EvaluatePage returns true, then a mismatch in checksums occurred
+			// A row is diffed from the first to the last of its chunks that mismatched, the rest of it matched its snapshot
+			//
+
+			std::vector<SWEEP_MISMATCH>::iterator MismatchEnd = State.Mismatches.Items.begin() + State.Mismatches.Size();
+			std::sort(State.Mismatches.Items.begin(), MismatchEnd);
+
+			for (std::vector<SWEEP_MISMATCH>::iterator Mismatch = State.Mismatches.Items.begin(); Mismatch != MismatchEnd;)
+			{
+				size_t PageIndex = Mismatch->PageIndex;
+				SIZE_T DirtyOffset = Mismatch->Offset;
+				SIZE_T DirtyEnd = Mismatch->Offset + Mismatch->Length;
+				for (++Mismatch; Mismatch != MismatchEnd && Mismatch->PageIndex == PageIndex; ++Mismatch)
+				{
+					DirtyEnd = (std::max)(DirtyEnd, Mismatch->Offset + Mismatch->Length);
+				}
+
+				const BYTE* Live = State.Window.Live[PageIndex - First];
+				typename HashPolicy::Checksum Checksum;
+				if (EvaluatePage(ViewPage(PageSet, PageIndex, Live), Checksum))
+				{
+					//
+					// A change the change queue had no room for is found by the next sweep, made full as in the dirty sweep,
+					// and the row stays due on it since it is scheduled as changed
+					//
+
+					if (!ReportPageChange(PageSet, Memory.ProcessId, PageIndex, Live, Checksum, DirtyOffset, DirtyEnd - DirtyOffset))
+					{
+						State.Sweep = 0;
+					}
+					ScheduleRow(State, PageIndex, true);
+				}
+			}
+			State.Cursor = Last;
+
+			if (Hashed >= Budget)
+			{
+				break;
+			}
+		}
+
+		if (State.Cursor < PageSet.Count())
+		{
+			return SweepPending;
+		}
+		State.Cursor = SIZE_MAX;
+
+		//
+		// Pages that could not be read are skipped, when it is because the process exited there is nothing left to scan
+		//
+
+		if (State.Unreadable && !IsProcessRunning(Memory))
+		{
+			std::cout << "Process " << std::dec << Memory.ProcessId << " exited" << std::endl;
+			return SweepExited;
+		}
+		State.Unreadable = false;
+		return SweepComplete;
+	}
+
+	//
+	// Dirty sweep, collect the pages written since the last reset and reset before checking them,
+	// so a write landing while they are checked is reported dirty again by the next sweep
+	// A failed query falls back to a full sweep next
+	//
+
+	State.DirtyPages.clear();
+	for (size_t PageIndex = 0; PageIndex < PageSet.Count(); PageIndex++)
+	{
+		State.DirtyOffsets.clear();
+		if (FindDirtyPages(State.Tracker, PageSet.Bases[PageIndex], PageSet.Sizes[PageIndex], State.DirtyOffsets))
+		{
+			State.Sweep = 0;
+			break;
+		}
+
+		for (SIZE_T Offset : State.DirtyOffsets)
+		{
+			State.DirtyPages.push_back({ PageIndex, Offset });
+		}
+	}
+	ResetDirtyPages(State.Tracker);
+	Hashed = State.DirtyPages.size() * State.Tracker.PageSize;
+
+	//
+	// Only the dirty pages are read (in one batch out-of-process) and hashed, against the page level of the checksum tree
+	// A region with a changed page is then evaluated and reported as by the full sweep
+	//
+
+	if (!IsLocalProcess(Memory))
+	{
+		State.DirtyStaging.resize(State.DirtyPages.size() * State.Tracker.PageSize);
+		State.DirtyReads.clear();
+		for (size_t Dirty = 0; Dirty < State.DirtyPages.size(); Dirty++)
+		{
+			size_t PageIndex = State.DirtyPages[Dirty].first;
+			SIZE_T Offset = State.DirtyPages[Dirty].second;
+			State.DirtyReads.push_back({ static_cast<BYTE*>(PageSet.Bases[PageIndex]) + Offset, State.DirtyStaging.data() + Dirty * State.Tracker.PageSize,
+				(std::min)(State.Tracker.PageSize, PageSet.Sizes[PageIndex] - Offset) });
+		}
+
+		if (ReadProcessRanges(Memory, State.DirtyReads.data(), State.DirtyReads.size()))
+		{
+			State.Sweep = 0;
+			return SweepComplete;
+		}
+	}
+
+	for (size_t Dirty = 0; Dirty < State.DirtyPages.size(); Dirty++)
+	{
+		size_t PageIndex = State.DirtyPages[Dirty].first;
+		SIZE_T Offset = State.DirtyPages[Dirty].second;
+		const BYTE* LivePage = IsLocalProcess(Memory) ? static_cast<const BYTE*>(PageSet.Bases[PageIndex]) + Offset : State.DirtyReads[Dirty].Local;
+		if (RangeMatchesTree(PageSet.Trees[PageIndex], LivePage, PageSet.Sizes[PageIndex], Offset, State.Tracker.PageSize))
+		{
+			continue;
+		}
+
+		//
+		// The region is diffed from this page to the end of its last dirty page, the pages not reported written are unchanged
+		//
+
+		while (Dirty + 1 < State.DirtyPages.size() && State.DirtyPages[Dirty + 1].first == PageIndex)
+		{
+			Dirty++;
+		}
+		SIZE_T DirtyEnd = State.DirtyPages[Dirty].second + State.Tracker.PageSize;
+
+		ReadLiveWindow(Memory, PageSet, PageIndex, 0, State.RegionWindow);
+		const BYTE* Live = State.RegionWindow.Live[0];
+		typename HashPolicy::Checksum Checksum;
+		if (Live && EvaluatePage(ViewPage(PageSet, PageIndex, Live), Checksum))
+		{
+			//
+			// Its dirty bit is already reset, a change the change queue had no room for is found by a full sweep next
+			//
+
+			if (!ReportPageChange(PageSet, Memory.ProcessId, PageIndex, Live, Checksum, Offset, DirtyEnd - Offset))
+			{
+				State.Sweep = 0;
+			}
+			ScheduleRow(State, PageIndex, true);
+		}
+	}
+	return SweepComplete;
+}
+
+/*++
+
+Routine Description:
+
+	Repeatedly sweeps the page table, comparing the checksum of each page with its snapshot, until PageEval is false
+	Sweeps run in slices paced by the scan governor (see governor.h), with the full sweeps on a pool of ScanThreadCount workers
+
+Parameters:
+
+	PageSet - The page table, with every page captured
+	Memory - The memory of the process the pages are in
+	PageEval - Keeps sweeping while true
+
+Return Value:
+
+	None
+
+--*/
+template <class HashPolicy>
+void SweepPageList(PAGE_TABLE<HashPolicy>& PageSet, PROCESS_MEMORY& Memory, const bool& PageEval)
+{
+	WORKER_POOL Pool;
+	StartWorkerPool(Pool, ScanThreadCount, ScanPinThreads);
+
+	SWEEP_STATE State;
+	OpenSweepState(State, Memory, &Pool);
+
+	//
+	// A stable page is checked every ScanColdMaxInterval full sweeps, and with dirty tracking a full sweep is every ScanVerifyInterval sweeps
+	//
+
+	size_t StaleSweeps = (ScanAdaptive ? ScanColdMaxInterval : 1) * (State.TrackDirty ? ScanVerifyInterval : 1);
+	SCAN_GOVERNOR Governor;
+	StartGovernor(Governor, ScanCpuBudget, ScanSweepPeriod, StaleSweeps);
+
+	SIZE_T TableBytes = 0;
+	for (size_t PageIndex = 0; PageIndex < PageSet.Count(); PageIndex++)
+	{
+		TableBytes += PageSet.Sizes[PageIndex];
+	}
+
+	while (PageEval)
+	{
+		SIZE_T Hashed = 0;
+		GovernorBeginSlice(Governor);
+		SWEEP_RESULT Result = SweepPageSlice(PageSet, Memory, State, GovernorSliceBytes(Governor), Hashed);
+		if (Result == SweepExited)
+		{
+			break;
+		}
+		GovernorEndSlice(Governor, Hashed, State.SliceThreads, TableBytes, Result == SweepComplete);
+	}
+
+	StopGovernor(Governor);
+	CloseSweepState(State);
+	StopWorkerPool(Pool);
+}
+
+/*++
+
+Routine Description:
+
+	Waits for the write monitor to report written pages, sleeping while nothing is written, until PageEval is false
+	Each batch of pages is re-armed, then each page is checked against the page level of its checksum tree,
+	a region with a changed page is evaluated and reported as by the sweep
+
+Parameters:
+
+	PageSet - The page table, with every page captured
+	Monitor - The started write monitor of the pages in PageSet, which are in the current process
+	PageEval - Keeps waiting while true
+
+Return Value:
+
+	None
+
+--*/
+template <class HashPolicy>
+void MonitorPageList(PAGE_TABLE<HashPolicy>& PageSet, WRITE_MONITOR& Monitor, const bool& PageEval)
+{
+	std::vector<WRITE_FAULT> Faults;
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+
+	while (PageEval && WaitWriteFaults(Monitor, ScanFaultSettle, Faults))
+	{
+		//
+		// Each batch of faults is an epoch, its pages are re-armed together before diffing,
+		// a write landing after this faults again and is handed out in a later epoch
+		//
+
+		RearmWritePages(Monitor, Faults);
+
+		for (const WRITE_FAULT& Fault : Faults)
+		{
+			size_t PageIndex = FindPageIndex(PageSet, Fault.Page);
+			if (PageIndex == PageSet.Count())
+			{
+				continue;
+			}
+
+			SIZE_T Offset = static_cast<BYTE*>(Fault.Page) - static_cast<BYTE*>(PageSet.Bases[PageIndex]);
+			if (RangeMatchesTree(PageSet.Trees[PageIndex], static_cast<const BYTE*>(Fault.Page), PageSet.Sizes[PageIndex], Offset, Monitor.PageSize))
+			{
+				continue;
+			}
+
+			std::cout << "Write fault: " << Fault.Page << " at " << std::dec
+				<< std::chrono::duration<double, std::milli>(Fault.Time - Start).count() << " ms\n";
+
+			//
+			// A change the change queue had no room for is handed out again, it is not written again necessarily
+			//
+
+			typename HashPolicy::Checksum Checksum;
+			if (EvaluatePage(ViewPage(PageSet, PageIndex), Checksum) &&
+				!ReportPageChange(PageSet, 0, PageIndex, static_cast<const BYTE*>(PageSet.Bases[PageIndex]), Checksum, Offset, Monitor.PageSize))
+			{
+				DeferWriteFault(Monitor, Fault);
+			}
+		}
+	}
+}
+
+/*++
+
+Routine Description:
+
+	Acquires all the pages of a module in a process using GetModulePages
+	Repeatedly loops over each page, comparing the checksum with the corresponding snapshot, detecting any mismatches, until PageEval is false
+	In-process, when the write monitor can be started, waits for written pages instead of looping
+
+Parameters:
+
+	ProcessId - The process the module is loaded in, 0 for the current process (injected), otherwise it is read out-of-process
+	ModuleName - The name of the module, empty for the main executable
+	PageEval - Keeps scanning while true
+
+Return Value:
+
+	DWORD - 0 or the error that prevented the module from being registered
+
+--*/
+template <class HashPolicy>
+DWORD ScanModule(DWORD ProcessId, LPWSTR ModuleName, const bool& PageEval)
+{
+	PAGE_TABLE<HashPolicy> PageSet = {};
+	PROCESS_MEMORY Memory;
+
+	DWORD StatusCode = OpenProcessMemory(Memory, ProcessId);
+	if (StatusCode)
+	{
+		std::cerr << "OpenProcessMemory encountered an error: " << StatusCode << std::endl;
+		return StatusCode;
+	}
+
+	StatusCode = GetModulePages(Memory, ModuleName, PageSet);
+	if (StatusCode)
+	{
+		DestroySnapshotArena(PageSet.Arena);
+		CloseProcessMemory(Memory);
+		return StatusCode;
+	}
+
+	std::cout << "Page list initialized. " << std::endl;
+	StartChangeConsumer(CHANGE_QUEUE_CAPACITY, ScanPromptMacroNames, ScanPatchDirectory);
+
+	//
+	// With ScanWriteFaults, prefer being told about writes by the write monitor, it only fails to start when the platform or kernel
+	// cannot write protect the regions, then the page table is swept. The monitor only intercepts writes in this process
+	//
+
+	WRITE_MONITOR Monitor;
+	DWORD MonitorStatus = ERROR_NOT_SUPPORTED;
+	if (ScanWriteFaults && IsLocalProcess(Memory))
+	{
+		MonitorStatus = StartWriteMonitor(Monitor, ScanWriteEngine, PageSet.Bases, PageSet.Sizes, PageSet.Protections);
+		if (MonitorStatus)
+		{
+			//
+			// Logged once, a later scan of the same kind of regions falls back for the same reason
+			//
+
+			static std::once_flag FallbackLogged;
+			std::call_once(FallbackLogged, [&]() {
+				std::cout << "Write monitor unavailable (" << MonitorStatus << ")"
+					<< (ScanWriteEngine == WriteMonitorUserfaultfd && MonitorStatus == EINVAL ? ", userfaultfd cannot write protect file-backed regions" : "")
+					<< (ScanWriteEngine == WriteMonitorTrap && MonitorStatus == ERROR_NOT_SUPPORTED ? ", the trap engine needs ScanWriteableRegions" : "")
+					<< ", sweeping" << std::endl;
+			});
+		}
+	}
+
+	if (!MonitorStatus)
+	{
+		std::cout << "Write monitor started" << std::endl;
+		MonitorPageList(PageSet, Monitor, PageEval);
+		StopWriteMonitor(Monitor);
+	}
+	else
+	{
+		SweepPageList(PageSet, Memory, PageEval);
+	}
+
+	StopChangeConsumer();
+	DestroySnapshotArena(PageSet.Arena);
+	CloseProcessMemory(Memory);
+	return 0;
+}
+
+/*++
+
+Routine Description:
+	
+	The injected scanner thread: asks for the module name, then scans the module in this process with ScanModule
+
+Parameters:
+
+	lpParam - Thread parameter, currently not in use
+
+Return Value:
+	
+	DWORD - Redundant value (NULL) currently
+
+--*/
+template <class HashPolicy>
+DWORD WINAPI EvaluatePageList(LPVOID lpParam)
+{
+	(void)lpParam;
+
+	//
+	// Acquire the list of memory pages within the module and register them in the PageSet page table
+	// Constantly evaluate the checksums of PageSet until PageEval is no longer true (indefinitely)
+	// WIP: PageEval flag
+	//
+
+	bool PageEval = true;
+	std::wstring ModuleName;
+
+	//
+	// Generate the CRC tables and select the CPUID-dispatched CRC engine and deep compare kernel before any page is registered
+	//
+
+	crc_initialize(crc_engine_automatic);
+	InitializeCompareKernel(CompareKernelAutomatic);
+
+	std::cout << "Module name: ";
+	std::getline(std::wcin, ModuleName);
+	ScanModule<HashPolicy>(0, const_cast<LPWSTR>(ModuleName.c_str()), PageEval);
+	return 0;
+}
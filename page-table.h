@@ -0,0 +1,238 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "platform.h"
+#include "checksum-tree.h"
+#include "module-table.h"
+#include "process-memory.h"
+#include "snapshot-arena.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#define PAGE_TABLE_PREFETCH(Address) _mm_prefetch(static_cast<const char*>(Address), _MM_HINT_T0)
+#else
+#define PAGE_TABLE_PREFETCH(Address) ((void)(Address))
+#endif
+
+//
+// How many pages ahead of the one being hashed the sweep prefetches, and how many of the first cache lines of that page
+// A single line only hides the first miss of the page, enough lines to cover the hardware prefetcher's ramp up keep the hash fed
+// until it streams the rest of the page (see tests/page-table-bench.cpp)
+//
+
+#define PAGE_PREFETCH_DISTANCE 4
+#define PAGE_PREFETCH_LINES 8
+#define PAGE_PREFETCH_LINE_SIZE 64
+
+//
+// Page Table
+// Structure-of-arrays of the registered pages: the sweep only reads Bases, Sizes and Checksums, linearly,
+// so those arrays stay dense in cache while the colder columns (protection, snapshot location, checksum tree) are only touched on a mismatch
+// Snapshots live back to back in the arena
+// Module is the module the pages were registered from and ModuleBase its base, changes are recorded relative to it
+//
+
+template <class HashPolicy>
+struct PAGE_TABLE
+{
+	std::vector<PVOID> Bases;
+	std::vector<SIZE_T> Sizes;
+	std::vector<typename HashPolicy::Checksum> Checksums;
+	std::vector<DWORD> Protections;
+	std::vector<BYTE*> Snapshots;
+	std::vector<CHECKSUM_TREE> Trees;
+	SNAPSHOT_ARENA Arena;
+	MODULE_ID Module = MODULE_MAIN_EXECUTABLE;
+	PVOID ModuleBase = NULL;
+
+	size_t Count() const
+	{
+		return Bases.size();
+	}
+
+	void Reserve(size_t Capacity)
+	{
+		Bases.reserve(Capacity);
+		Sizes.reserve(Capacity);
+		Checksums.reserve(Capacity);
+		Protections.reserve(Capacity);
+		Snapshots.reserve(Capacity);
+		Trees.reserve(Capacity);
+	}
+};
+
+//
+// Memory Differentiation View
+// Non-owning view of one row of the page table, the sweep only reads through it so no page or snapshot is ever copied
+// Valid for as long as the page table is not modified (it is not modified while sweeping)
+// LiveData is the page's current contents: BaseAddress itself in-process, a copy read out of the process otherwise
+//
+
+template <class HashPolicy>
+struct MEM_DIFF_VIEW
+{
+	PVOID BaseAddress;
+	const BYTE* LiveData;
+	SIZE_T RegionSize;
+	const typename HashPolicy::Checksum* Checksum;
+	const BYTE* PageData;
+	const CHECKSUM_TREE* Tree;
+};
+
+template <class HashPolicy>
+inline MEM_DIFF_VIEW<HashPolicy> ViewPage(const PAGE_TABLE<HashPolicy>& Table, size_t Index, const BYTE* LiveData)
+{
+	return { Table.Bases[Index], LiveData, Table.Sizes[Index], &Table.Checksums[Index], Table.Snapshots[Index], &Table.Trees[Index] };
+}
+
+template <class HashPolicy>
+inline MEM_DIFF_VIEW<HashPolicy> ViewPage(const PAGE_TABLE<HashPolicy>& Table, size_t Index)
+{
+	return ViewPage(Table, Index, static_cast<const BYTE*>(Table.Bases[Index]));
+}
+
+//
+// Live Window
+// The live contents of a run of consecutive pages: the pages themselves in-process, otherwise copies read in one batch
+// Live holds NULL for a page that could not be read (e.g. unmapped since it was registered)
+//
+
+typedef struct _LIVE_WINDOW
+{
+	std::vector<const BYTE*> Live;
+	std::vector<PROCESS_READ> Reads;
+	std::vector<BYTE> Staging;
+} LIVE_WINDOW;
+
+/*++
+
+Routine Description:
+
+	Makes the live contents of the pages from First on available, as many wanted pages as fit in WindowSize bytes (at least one)
+	Out-of-process the pages are read with a single batched read, retried page by page when it fails
+
+Parameters:
+
+	Memory - The memory of the process the pages are in
+	Table - The page table
+	First - The index of the first page of the window
+	WindowSize - The most bytes to read at once, in-process nothing is read and the window only bounds the pages returned
+	Window - Receives the live contents, Window.Live[Index - First] for each page of the window
+	Wanted - Wanted(Index) is false for the pages to leave out, they are neither read nor counted and their Live is NULL
+
+Return Value:
+
+	size_t - The index after the last page of the window
+
+--*/
+template <class HashPolicy, class ROW_FILTER>
+size_t ReadLiveWindow(PROCESS_MEMORY& Memory, const PAGE_TABLE<HashPolicy>& Table, size_t First, SIZE_T WindowSize, LIVE_WINDOW& Window, ROW_FILTER Wanted)
+{
+	Window.Live.clear();
+	Window.Reads.clear();
+
+	size_t Last = First;
+	SIZE_T Bytes = 0;
+	for (; Last < Table.Count(); Last++)
+	{
+		if (!Wanted(Last))
+		{
+			Window.Live.push_back(NULL);
+			continue;
+		}
+
+		if (Bytes && Bytes + Table.Sizes[Last] > WindowSize)
+		{
+			break;
+		}
+
+		Window.Live.push_back(static_cast<const BYTE*>(Table.Bases[Last]));
+		Window.Reads.push_back({ Table.Bases[Last], reinterpret_cast<BYTE*>(Bytes), Table.Sizes[Last] });
+		Bytes += Table.Sizes[Last];
+	}
+
+	if (IsLocalProcess(Memory))
+	{
+		return Last;
+	}
+
+	//
+	// The reads were recorded with their offsets into the staging buffer, which is only sized now
+	//
+
+	Window.Staging.resize(Bytes);
+	for (size_t Index = 0, Read = 0; Index < Window.Live.size(); Index++)
+	{
+		if (Window.Live[Index])
+		{
+			Window.Reads[Read].Local = Window.Staging.data() + reinterpret_cast<SIZE_T>(Window.Reads[Read].Local);
+			Window.Live[Index] = Window.Reads[Read].Local;
+			Read++;
+		}
+	}
+
+	if (ReadProcessRanges(Memory, Window.Reads.data(), Window.Reads.size()))
+	{
+		for (size_t Index = 0, Read = 0; Index < Window.Live.size(); Index++)
+		{
+			if (Window.Live[Index] && ReadProcessRanges(Memory, &Window.Reads[Read++], 1))
+			{
+				Window.Live[Index] = NULL;
+			}
+		}
+	}
+	return Last;
+}
+
+template <class HashPolicy>
+size_t ReadLiveWindow(PROCESS_MEMORY& Memory, const PAGE_TABLE<HashPolicy>& Table, size_t First, SIZE_T WindowSize, LIVE_WINDOW& Window)
+{
+	return ReadLiveWindow(Memory, Table, First, WindowSize, Window, [](size_t) { return true; });
+}
+
+//
+// Finds the row of the page containing Address, rows are registered in ascending address order
+// Returns Count() when no registered page contains it
+//
+
+template <class HashPolicy>
+inline size_t FindPageIndex(const PAGE_TABLE<HashPolicy>& Table, const void* Address)
+{
+	std::vector<PVOID>::const_iterator Next = std::upper_bound(Table.Bases.begin(), Table.Bases.end(), Address,
+		[](const void* Value, PVOID Base) { return static_cast<const BYTE*>(Value) < static_cast<const BYTE*>(Base); });
+	if (Next == Table.Bases.begin())
+	{
+		return Table.Count();
+	}
+
+	size_t Index = (Next - Table.Bases.begin()) - 1;
+	if (static_cast<const BYTE*>(Address) >= static_cast<const BYTE*>(Table.Bases[Index]) + Table.Sizes[Index])
+	{
+		return Table.Count();
+	}
+	return Index;
+}
@@ -0,0 +1,220 @@
+#include "pch.h"
+#include "patch-applier.h"
+#include <cstring>
+
+/*++
+
+Routine Description:
+
+	Resolves the base of the module a diff set or patch was captured in, and starts collecting its ranges
+	When the base cannot be resolved every range fails with the error, nothing is read or written
+
+Parameters:
+
+	Applier - The applier
+	Bases - The module bases of the process
+	Module - The module of the diff set or patch
+	Count - The number of ranges
+	ModuleBase - Receives the base of the module in the process
+
+Return Value:
+
+	DWORD - 0 or the error resolving the module base
+
+--*/
+static DWORD BeginApply(PATCH_APPLIER& Applier, MODULE_BASES& Bases, MODULE_ID Module, size_t Count, PVOID& ModuleBase)
+{
+	Applier.Ranges.clear();
+	DWORD StatusCode = ResolveModuleBase(Bases, Module, ModuleBase);
+	if (StatusCode)
+	{
+		Applier.Outcomes.assign(Count, PatchFailed);
+		Applier.Errors.assign(Count, StatusCode);
+	}
+	return StatusCode;
+}
+
+/*++
+
+Routine Description:
+
+	Applies the collected ranges in a process, range by range
+	A range holding the bytes it replaces is written, one already holding the bytes it writes is left alone (PatchUnchanged),
+	any other is not written (PatchMismatch). When the batched read fails, the ranges are read one by one so only the ranges
+	that cannot be read fail
+
+Parameters:
+
+	Applier - The applier with the ranges collected, receives the outcome of every range in Outcomes and Errors
+	Memory - The memory of the process to patch, opened writeable
+
+Return Value:
+
+	DWORD - 0 when every range was written or unchanged, otherwise ERROR_INVALID_DATA or the error of the first range that failed
+
+--*/
+static DWORD ApplyRanges(PATCH_APPLIER& Applier, PROCESS_MEMORY& Memory)
+{
+	size_t Count = Applier.Ranges.size();
+	SIZE_T Total = 0;
+	for (const PATCH_RANGE& Range : Applier.Ranges)
+	{
+		Total += Range.Length;
+	}
+
+	Applier.Current.resize(Total);
+	Applier.Reads.clear();
+	Applier.Writes.clear();
+	Applier.Pending.clear();
+	Applier.Outcomes.assign(Count, PatchWritten);
+	Applier.Errors.assign(Count, 0);
+
+	SIZE_T Position = 0;
+	for (const PATCH_RANGE& Range : Applier.Ranges)
+	{
+		Applier.Reads.push_back({ Range.Remote, Applier.Current.data() + Position, Range.Length });
+		Position += Range.Length;
+	}
+
+	if (ReadProcessRanges(Memory, Applier.Reads.data(), Count))
+	{
+		for (size_t Index = 0; Index < Count; Index++)
+		{
+			DWORD StatusCode = ReadProcessRanges(Memory, &Applier.Reads[Index], 1);
+			if (StatusCode)
+			{
+				Applier.Outcomes[Index] = PatchFailed;
+				Applier.Errors[Index] = StatusCode;
+			}
+		}
+	}
+
+	//
+	// Verify every range against the side it replaces, only the ones that hold it are written
+	//
+
+	for (size_t Index = 0; Index < Count; Index++)
+	{
+		if (Applier.Outcomes[Index] == PatchFailed)
+		{
+			continue;
+		}
+
+		const PATCH_RANGE& Range = Applier.Ranges[Index];
+		const BYTE* Current = Applier.Reads[Index].Local;
+
+		if (!memcmp(Current, Range.Written, Range.Length))
+		{
+			Applier.Outcomes[Index] = PatchUnchanged;
+		}
+		else if (memcmp(Current, Range.Replaced, Range.Length))
+		{
+			Applier.Outcomes[Index] = PatchMismatch;
+			Applier.Errors[Index] = ERROR_INVALID_DATA;
+		}
+		else
+		{
+			Applier.Writes.push_back({ Range.Remote, Range.Written, Range.Length });
+			Applier.Pending.push_back(Index);
+		}
+	}
+
+	Applier.WriteResults.resize(Applier.Writes.size());
+	WriteProcessRanges(Memory, Applier.Writes.data(), Applier.Writes.size(), Applier.WriteResults.data());
+
+	for (size_t Write = 0; Write < Applier.Pending.size(); Write++)
+	{
+		if (Applier.WriteResults[Write])
+		{
+			Applier.Outcomes[Applier.Pending[Write]] = PatchFailed;
+			Applier.Errors[Applier.Pending[Write]] = Applier.WriteResults[Write];
+		}
+	}
+
+	for (DWORD Error : Applier.Errors)
+	{
+		if (Error)
+		{
+			return Error;
+		}
+	}
+	return 0;
+}
+
+/*++
+
+Routine Description:
+
+	Applies (DiffApply) or reverts (DiffUndo) a diff set in a process, range by range (see ApplyRanges)
+
+Parameters:
+
+	Applier - The applier, receives the outcome of every range in Outcomes and Errors
+	Memory - The memory of the process to patch, opened writeable
+	Bases - The module bases of the process, the diff set's module is resolved through it
+	Diff - The diff set
+	Direction - DiffApply writes the changed bytes, DiffUndo restores the original bytes
+
+Return Value:
+
+	DWORD - 0 when every range was written or unchanged, otherwise ERROR_INVALID_DATA or the error of the first range that failed,
+		or the error resolving the module base, when nothing was read or written
+
+--*/
+DWORD ApplyDiffSet(PATCH_APPLIER& Applier, PROCESS_MEMORY& Memory, MODULE_BASES& Bases, const DIFF_SET& Diff, DIFF_DIRECTION Direction)
+{
+	PVOID ModuleBase = NULL;
+	DWORD StatusCode = BeginApply(Applier, Bases, Diff.Module, Diff.Ranges.size(), ModuleBase);
+	if (StatusCode)
+	{
+		return StatusCode;
+	}
+
+	DIFF_DIRECTION Replaced = Direction == DiffApply ? DiffUndo : DiffApply;
+	for (const DIFF_RANGE& Range : Diff.Ranges)
+	{
+		Applier.Ranges.push_back({ DiffRangeAddress(Diff, Range, ModuleBase), DiffRangeBytes(Diff, Range, Direction),
+			DiffRangeBytes(Diff, Range, Replaced), Range.Length });
+	}
+	return ApplyRanges(Applier, Memory);
+}
+
+/*++
+
+Routine Description:
+
+	Applies (DiffApply) or reverts (DiffUndo) a patch in a process, record by record (see ApplyRanges)
+	Both sides of a record are read in place from the mapping, which OpenPatchFile validated against the file's checksum,
+	so applying a patch twice is harmless: the second time every record is PatchUnchanged
+
+Parameters:
+
+	Applier - The applier, receives the outcome of every record in Outcomes and Errors
+	Memory - The memory of the process to patch, opened writeable
+	Bases - The module bases of the process, the patch's module is resolved through it
+	Patch - The opened patch
+	Direction - DiffApply writes the changed bytes, DiffUndo restores the original bytes
+
+Return Value:
+
+	DWORD - 0 when every record was written or unchanged, otherwise ERROR_INVALID_DATA or the error of the first record that failed,
+		or the error resolving the module base, when nothing was read or written
+
+--*/
+DWORD ApplyPatchFile(PATCH_APPLIER& Applier, PROCESS_MEMORY& Memory, MODULE_BASES& Bases, const PATCH_FILE& Patch, DIFF_DIRECTION Direction)
+{
+	PVOID ModuleBase = NULL;
+	DWORD StatusCode = BeginApply(Applier, Bases, Patch.Module, Patch.Records.size(), ModuleBase);
+	if (StatusCode)
+	{
+		return StatusCode;
+	}
+
+	DIFF_DIRECTION Replaced = Direction == DiffApply ? DiffUndo : DiffApply;
+	for (const PATCH_RECORD* Record : Patch.Records)
+	{
+		Applier.Ranges.push_back({ static_cast<BYTE*>(ModuleBase) + Record->Offset, PatchRecordBytes(Record, Direction),
+			PatchRecordBytes(Record, Replaced), Record->Length });
+	}
+	return ApplyRanges(Applier, Memory);
+}
@@ -0,0 +1,82 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+#include <vector>
+#include "platform.h"
+#include "diff-range.h"
+#include "module-table.h"
+#include "patch-file.h"
+#include "process-memory.h"
+
+//
+// Patch Applier
+// Applies a diff set (the change, or its undo) to a process without generated code: the bytes of every range are read in one batch
+// and compared with the side being replaced, then the ranges that hold it are written in as few process_vm_writev calls as the
+// pages allow (see WriteProcessRanges). Each range reports its own outcome, a range that does not match is never written
+// The buffers are kept from one call to the next, so applying steadily (e.g. rolling a change back across many processes) does not
+// allocate. An applier is used by one thread at a time, a thread applying to many processes keeps one applier for all of them
+// The diff set is module-relative, its ranges are relocated into each process with that process's MODULE_BASES: one addition per range
+// A patch file (see patch-file.h) is applied through the same path, a record is a range with both of its sides in the mapping
+//
+
+typedef enum _PATCH_OUTCOME
+{
+	PatchWritten,
+	PatchUnchanged,
+	PatchMismatch,
+	PatchFailed
+} PATCH_OUTCOME;
+
+//
+// A range to apply, relocated into the process: the bytes it writes and the bytes it replaces, each Length long
+//
+
+typedef struct _PATCH_RANGE
+{
+	PVOID Remote;
+	const BYTE* Written;
+	const BYTE* Replaced;
+	SIZE_T Length;
+} PATCH_RANGE;
+
+typedef struct _PATCH_APPLIER
+{
+	std::vector<PATCH_RANGE> Ranges;
+	std::vector<BYTE> Current;
+	std::vector<PROCESS_READ> Reads;
+	std::vector<PROCESS_WRITE> Writes;
+	std::vector<size_t> Pending;
+	std::vector<DWORD> WriteResults;
+
+	//
+	// The outcome of each range (or record) of the last diff set or patch applied, and its error when PatchFailed
+	//
+
+	std::vector<PATCH_OUTCOME> Outcomes;
+	std::vector<DWORD> Errors;
+} PATCH_APPLIER;
+
+DWORD ApplyDiffSet(PATCH_APPLIER& Applier, PROCESS_MEMORY& Memory, MODULE_BASES& Bases, const DIFF_SET& Diff, DIFF_DIRECTION Direction);
+DWORD ApplyPatchFile(PATCH_APPLIER& Applier, PROCESS_MEMORY& Memory, MODULE_BASES& Bases, const PATCH_FILE& Patch, DIFF_DIRECTION Direction);
@@ -0,0 +1,238 @@
+#include "pch.h"
+#include "patch-file.h"
+#include "error-checking.h"
+#include <cstdlib>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static unsigned int PatchChecksum(const BYTE* Data, SIZE_T Length)
+{
+	return crc32c_crypt(const_cast<BYTE*>(Data), static_cast<crc_size>(Length));
+}
+
+/*++
+
+Routine Description:
+
+	Checks the mapped patch: header, trailer, checksum, and the bounds and checksums of every record, then collects the records
+
+Parameters:
+
+	Patch - The mapped patch, View and Size set
+
+Return Value:
+
+	DWORD - 0 or ERROR_INVALID_DATA when the file is not a patch, is truncated or fails its checksum,
+		or its module name is not valid in the current locale
+
+--*/
+static DWORD ValidatePatchFile(PATCH_FILE& Patch)
+{
+	if (Patch.Size < sizeof(PATCH_HEADER) + sizeof(PATCH_TRAILER) || Patch.Size % PATCH_ALIGNMENT)
+	{
+		return ERROR_INVALID_DATA;
+	}
+
+	const PATCH_HEADER* Header = reinterpret_cast<const PATCH_HEADER*>(Patch.View);
+	SIZE_T TrailerOffset = Patch.Size - sizeof(PATCH_TRAILER);
+	const PATCH_TRAILER* Trailer = reinterpret_cast<const PATCH_TRAILER*>(Patch.View + TrailerOffset);
+
+	if (Header->Magic != PATCH_MAGIC || Header->Version != PATCH_VERSION || Header->FileSize != Patch.Size || Trailer->Magic != PATCH_MAGIC ||
+		PatchChecksum(Patch.View, TrailerOffset) != Trailer->Checksum)
+	{
+		return ERROR_INVALID_DATA;
+	}
+
+	SIZE_T Cursor = sizeof(PATCH_HEADER);
+	if (Header->NameLength > TrailerOffset - Cursor)
+	{
+		return ERROR_INVALID_DATA;
+	}
+	Patch.ModuleName.assign(reinterpret_cast<const char*>(Patch.View + Cursor), Header->NameLength);
+	Cursor += PatchAlign(Header->NameLength);
+
+	//
+	// Each record is followed by both sides of its bytes, 2 * Length, then padding to the next record
+	// Both sides must match the record's checksums, so a record holds the bytes it was written with on its own
+	//
+
+	Patch.Records.clear();
+	Patch.Records.reserve(Header->RecordCount);
+	for (DWORD Index = 0; Index < Header->RecordCount; Index++)
+	{
+		if (Cursor > TrailerOffset || TrailerOffset - Cursor < sizeof(PATCH_RECORD))
+		{
+			return ERROR_INVALID_DATA;
+		}
+
+		const PATCH_RECORD* Record = reinterpret_cast<const PATCH_RECORD*>(Patch.View + Cursor);
+		if (2 * static_cast<unsigned long long>(Record->Length) > TrailerOffset - Cursor - sizeof(PATCH_RECORD))
+		{
+			return ERROR_INVALID_DATA;
+		}
+
+		if (PatchChecksum(PatchRecordBytes(Record, DiffApply), Record->Length) != Record->NewHash ||
+			PatchChecksum(PatchRecordBytes(Record, DiffUndo), Record->Length) != Record->OldHash)
+		{
+			return ERROR_INVALID_DATA;
+		}
+
+		Patch.Records.push_back(Record);
+		Cursor += PatchAlign(sizeof(PATCH_RECORD) + 2 * static_cast<SIZE_T>(Record->Length));
+	}
+
+	if (Cursor != TrailerOffset)
+	{
+		return ERROR_INVALID_DATA;
+	}
+
+	//
+	// Intern the module, its base in each process is then resolved through that process's MODULE_BASES
+	//
+
+	std::wstring ModuleName;
+	if (!Patch.ModuleName.empty())
+	{
+		size_t Length = std::mbstowcs(NULL, Patch.ModuleName.c_str(), 0);
+		if (Length == static_cast<size_t>(-1))
+		{
+			return ERROR_INVALID_DATA;
+		}
+		ModuleName.resize(Length + 1);
+		ModuleName.resize(std::mbstowcs(&ModuleName[0], Patch.ModuleName.c_str(), ModuleName.size()));
+	}
+
+	Patch.Module = RegisterModule(ModuleName.c_str());
+	Patch.Header = Header;
+	return 0;
+}
+
+/*++
+
+Routine Description:
+
+	Maps a patch file read-only and validates it, the records are read in place from the mapping
+	crc_initialize must have run, the checksums are CRC32C
+
+Parameters:
+
+	Patch - Receives the mapped patch, closed with ClosePatchFile whether or not it opened
+	Path - The path of the patch file
+
+Return Value:
+
+	DWORD - 0, ERROR_INVALID_DATA for a malformed patch, or GetLastError() (errno on Linux)
+
+--*/
+DWORD OpenPatchFile(PATCH_FILE& Patch, const char* Path)
+{
+	Patch.View = NULL;
+	Patch.Size = 0;
+	Patch.Header = NULL;
+	Patch.ModuleName.clear();
+	Patch.Module = MODULE_MAIN_EXECUTABLE;
+	Patch.Records.clear();
+
+#if defined(_WIN32)
+	Patch.Mapping = NULL;
+	Patch.File = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (Patch.File == INVALID_HANDLE_VALUE)
+	{
+		return GetLastError();
+	}
+
+	LARGE_INTEGER FileSize;
+	if (!GetFileSizeEx(Patch.File, &FileSize))
+	{
+		return GetLastError();
+	}
+
+	if (FileSize.QuadPart < static_cast<long long>(sizeof(PATCH_HEADER)))
+	{
+		return ERROR_INVALID_DATA;
+	}
+
+	Patch.Mapping = CreateFileMappingW(Patch.File, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!Patch.Mapping)
+	{
+		return GetLastError();
+	}
+
+	Patch.View = static_cast<const BYTE*>(MapViewOfFile(Patch.Mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!Patch.View)
+	{
+		return GetLastError();
+	}
+	Patch.Size = static_cast<SIZE_T>(FileSize.QuadPart);
+#else
+	int File = open(Path, O_RDONLY | O_CLOEXEC);
+	if (File < 0)
+	{
+		return errno;
+	}
+
+	struct stat Status;
+	if (fstat(File, &Status))
+	{
+		DWORD StatusCode = errno;
+		close(File);
+		return StatusCode;
+	}
+
+	if (Status.st_size < static_cast<off_t>(sizeof(PATCH_HEADER)))
+	{
+		close(File);
+		return ERROR_INVALID_DATA;
+	}
+
+	void* View = mmap(NULL, static_cast<size_t>(Status.st_size), PROT_READ, MAP_PRIVATE, File, 0);
+	DWORD StatusCode = View == MAP_FAILED ? errno : 0;
+	close(File);
+	if (StatusCode)
+	{
+		return StatusCode;
+	}
+
+	Patch.View = static_cast<const BYTE*>(View);
+	Patch.Size = static_cast<SIZE_T>(Status.st_size);
+#endif
+
+	return ValidatePatchFile(Patch);
+}
+
+void ClosePatchFile(PATCH_FILE& Patch)
+{
+#if defined(_WIN32)
+	if (Patch.View)
+	{
+		UnmapViewOfFile(Patch.View);
+	}
+
+	if (Patch.Mapping)
+	{
+		CloseHandle(Patch.Mapping);
+	}
+
+	if (Patch.File != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(Patch.File);
+	}
+	Patch.Mapping = NULL;
+	Patch.File = INVALID_HANDLE_VALUE;
+#else
+	if (Patch.View)
+	{
+		munmap(const_cast<BYTE*>(Patch.View), Patch.Size);
+	}
+#endif
+	Patch.View = NULL;
+	Patch.Size = 0;
+	Patch.Header = NULL;
+	Patch.Records.clear();
+}
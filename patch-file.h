@@ -0,0 +1,108 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+#include "platform.h"
+#include "diff-range.h"
+#include "module-table.h"
+
+//
+// Patch File
+// The binary form of a change, written by WritePatch (see macrowriter.h) next to the macro, for replaying a change without
+// compiling it. All fields are little-endian and every section starts 8-byte aligned, so a mapped file is read in place:
+//
+//	PATCH_HEADER
+//	ModuleName - NameLength bytes, the multibyte name of the module, empty for the main executable of whichever process it is applied to
+//	PATCH_RECORD, then Length changed bytes, then Length original bytes - RecordCount times
+//	PATCH_TRAILER - the CRC32C of every byte before it
+//
+// Record offsets are relative to the module base, ModuleBase is the base the change was captured at (for reference, a patch applies
+// wherever the module is loaded)
+// Each record carries both sides and the CRC32C of both, checked by OpenPatchFile along with the file's checksum
+// A patch is applied or reverted only where the process holds, byte for byte, the side being replaced (or already the side written)
+// A patch is applied with ApplyPatchFile (see patch-applier.h), the same way as a captured diff set
+//
+
+#define PATCH_MAGIC 0x5450444D
+#define PATCH_VERSION 1
+#define PATCH_ALIGNMENT 8
+
+typedef struct _PATCH_HEADER
+{
+	DWORD Magic;
+	DWORD Version;
+	DWORD RecordCount;
+	DWORD NameLength;
+	unsigned long long ModuleBase;
+	unsigned long long FileSize;
+} PATCH_HEADER;
+
+typedef struct _PATCH_RECORD
+{
+	unsigned long long Offset;
+	DWORD Length;
+	DWORD NewHash;
+	DWORD OldHash;
+	DWORD Reserved;
+} PATCH_RECORD;
+
+typedef struct _PATCH_TRAILER
+{
+	DWORD Checksum;
+	DWORD Magic;
+} PATCH_TRAILER;
+
+inline SIZE_T PatchAlign(SIZE_T Size)
+{
+	return (Size + PATCH_ALIGNMENT - 1) & ~static_cast<SIZE_T>(PATCH_ALIGNMENT - 1);
+}
+
+// the bytes a record writes (DiffApply) or restores (DiffUndo)
+inline const BYTE* PatchRecordBytes(const PATCH_RECORD* Record, DIFF_DIRECTION Direction)
+{
+	return reinterpret_cast<const BYTE*>(Record + 1) + (Direction == DiffApply ? 0 : Record->Length);
+}
+
+//
+// A validated patch file mapped read-only, Records point into the mapping, Module is ModuleName interned in this process
+//
+
+typedef struct _PATCH_FILE
+{
+	const BYTE* View;
+	SIZE_T Size;
+	const PATCH_HEADER* Header;
+	std::string ModuleName;
+	MODULE_ID Module;
+	std::vector<const PATCH_RECORD*> Records;
+#if defined(_WIN32)
+	HANDLE File;
+	HANDLE Mapping;
+#endif
+} PATCH_FILE;
+
+DWORD OpenPatchFile(PATCH_FILE& Patch, const char* Path);
+void ClosePatchFile(PATCH_FILE& Patch);
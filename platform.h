@@ -0,0 +1,115 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+
+//
+// Platform layer
+// On Windows this is <Windows.h>. Elsewhere it provides the handful of Win32 types and constants the scanner is written against,
+// so the core compiles unchanged and only the backends (regions, snapshot arena, entry point) are platform specific
+// Protections are always expressed as PAGE_* values, status codes are GetLastError() values on Windows and errno values elsewhere
+//
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+typedef uint8_t BYTE;
+typedef uint32_t DWORD;
+typedef uintptr_t DWORD_PTR;
+typedef size_t SIZE_T;
+typedef int BOOL;
+typedef void* PVOID;
+typedef void* LPVOID;
+typedef const void* LPCVOID;
+typedef wchar_t* LPWSTR;
+typedef const wchar_t* LPCWSTR;
+
+#define WINAPI
+#define TRUE 1
+#define FALSE 0
+
+#define PAGE_NOACCESS 0x01
+#define PAGE_READONLY 0x02
+#define PAGE_READWRITE 0x04
+#define PAGE_WRITECOPY 0x08
+#define PAGE_EXECUTE 0x10
+#define PAGE_EXECUTE_READ 0x20
+#define PAGE_EXECUTE_READWRITE 0x40
+
+#define ERROR_FILE_NOT_FOUND ENOENT
+#define ERROR_NOT_ENOUGH_MEMORY ENOMEM
+#define ERROR_INVALID_PARAMETER EINVAL
+#define ERROR_NOT_SUPPORTED EOPNOTSUPP
+#define ERROR_INVALID_DATA EBADMSG
+#endif
+
+//
+// Per-function instruction set targets, MSVC compiles any intrinsic without them
+//
+
+#if defined(_MSC_VER)
+#define PLATFORM_TARGET(Features)
+#else
+#define PLATFORM_TARGET(Features) __attribute__((target(Features)))
+#endif
+
+//
+// CPUID and XGETBV, for the runtime dispatched kernels
+//
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define PLATFORM_X86
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+inline void PlatformCpuid(int CpuInfo[4], int Leaf, int SubLeaf = 0)
+{
+#if defined(_MSC_VER)
+	__cpuidex(CpuInfo, Leaf, SubLeaf);
+#else
+	__cpuid_count(Leaf, SubLeaf, CpuInfo[0], CpuInfo[1], CpuInfo[2], CpuInfo[3]);
+#endif
+}
+
+inline unsigned long long PlatformXgetbv(unsigned int Index)
+{
+#if defined(_MSC_VER)
+	return _xgetbv(Index);
+#else
+	unsigned int Low;
+	unsigned int High;
+	__asm__ __volatile__("xgetbv" : "=a"(Low), "=d"(High) : "c"(Index));
+	return (static_cast<unsigned long long>(High) << 32) | Low;
+#endif
+}
+#endif
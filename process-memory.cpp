@@ -0,0 +1,460 @@
+#include "pch.h"
+#include "process-memory.h"
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <cstdio>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+/*++
+
+Routine Description:
+
+	Opens the memory of a process for reading, and for writing when Writeable
+
+Parameters:
+
+	Memory - Receives the opened process memory
+	ProcessId - The process to read, 0 for the current process
+	Writeable - Also open it for WriteProcessRanges
+
+Return Value:
+
+	DWORD - 0 or GetLastError() (errno on Linux)
+
+--*/
+DWORD OpenProcessMemory(PROCESS_MEMORY& Memory, DWORD ProcessId, bool Writeable)
+{
+	Memory.ProcessId = ProcessId;
+
+#if defined(_WIN32)
+	Memory.Process = NULL;
+	if (ProcessId)
+	{
+		DWORD Access = PROCESS_VM_READ | PROCESS_QUERY_INFORMATION | (Writeable ? PROCESS_VM_WRITE | PROCESS_VM_OPERATION : 0);
+		Memory.Process = OpenProcess(Access, FALSE, ProcessId);
+		if (!Memory.Process)
+		{
+			return GetLastError();
+		}
+	}
+	else if (Writeable)
+	{
+		Memory.Process = GetCurrentProcess();
+	}
+#else
+	Memory.Memory = -1;
+	Memory.VectorReads = true;
+	Memory.VectorWrites = true;
+	if (ProcessId || Writeable)
+	{
+		//
+		// Both readers need ptrace read access to the process, /proc/<pid>/mem is opened up front so it is there to fall back to
+		// Writes always go through it, so opened writeable it must open
+		//
+
+		char Path[64];
+		if (ProcessId)
+		{
+			snprintf(Path, sizeof(Path), "/proc/%u/mem", ProcessId);
+		}
+		else
+		{
+			snprintf(Path, sizeof(Path), "/proc/self/mem");
+		}
+
+		Memory.Memory = open(Path, (Writeable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+		if (Memory.Memory < 0 && (Writeable || (errno != EACCES && errno != EPERM)))
+		{
+			return errno;
+		}
+	}
+#endif
+	return 0;
+}
+
+#if !defined(_WIN32)
+static DWORD ReadProcessFile(PROCESS_MEMORY& Memory, const PROCESS_READ* Reads, size_t Count, SIZE_T Done)
+{
+	if (Memory.Memory < 0)
+	{
+		return EPERM;
+	}
+
+	for (size_t Index = 0; Index < Count; Index++, Done = 0)
+	{
+		while (Done < Reads[Index].Size)
+		{
+			ssize_t Read = pread(Memory.Memory, Reads[Index].Local + Done, Reads[Index].Size - Done,
+				static_cast<off_t>(reinterpret_cast<size_t>(Reads[Index].Remote) + Done));
+			if (Read < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				return errno;
+			}
+
+			if (Read == 0)
+			{
+				return EFAULT;
+			}
+			Done += Read;
+		}
+	}
+	return 0;
+}
+#endif
+
+/*++
+
+Routine Description:
+
+	Reads a batch of ranges of the process, as few calls into the OS as possible
+	On Linux up to PROCESS_READ_BATCH ranges go into one process_vm_readv, a short read (which stops at the range that failed)
+	continues from where it stopped. If the kernel or the ptrace policy refuses process_vm_readv, this and every later read
+	of the process uses /proc/<pid>/mem instead
+
+Parameters:
+
+	Memory - The opened process memory
+	Reads - The ranges to read, each into its own local buffer
+	Count - The number of ranges
+
+Return Value:
+
+	DWORD - 0 or GetLastError() (errno on Linux), when not 0 the buffers are partially filled
+
+--*/
+DWORD ReadProcessRanges(PROCESS_MEMORY& Memory, const PROCESS_READ* Reads, size_t Count)
+{
+	if (IsLocalProcess(Memory))
+	{
+		for (size_t Index = 0; Index < Count; Index++)
+		{
+			memcpy(Reads[Index].Local, Reads[Index].Remote, Reads[Index].Size);
+		}
+		return 0;
+	}
+
+#if defined(_WIN32)
+	for (size_t Index = 0; Index < Count; Index++)
+	{
+		if (!ReadProcessMemory(Memory.Process, Reads[Index].Remote, Reads[Index].Local, Reads[Index].Size, NULL))
+		{
+			return GetLastError();
+		}
+	}
+	return 0;
+#else
+	size_t Next = 0;
+	SIZE_T Done = 0;
+
+	while (Next < Count && Memory.VectorReads.load(std::memory_order_relaxed))
+	{
+		iovec Local[PROCESS_READ_BATCH];
+		iovec Remote[PROCESS_READ_BATCH];
+
+		size_t Batch = 0;
+		for (size_t Index = Next; Index < Count && Batch < PROCESS_READ_BATCH; Index++, Batch++)
+		{
+			SIZE_T Skip = (Index == Next) ? Done : 0;
+			Local[Batch].iov_base = Reads[Index].Local + Skip;
+			Local[Batch].iov_len = Reads[Index].Size - Skip;
+			Remote[Batch].iov_base = static_cast<BYTE*>(Reads[Index].Remote) + Skip;
+			Remote[Batch].iov_len = Reads[Index].Size - Skip;
+		}
+
+		ssize_t Read = process_vm_readv(static_cast<pid_t>(Memory.ProcessId), Local, Batch, Remote, Batch, 0);
+		if (Read < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			if (errno == ENOSYS || errno == EPERM)
+			{
+				Memory.VectorReads.store(false, std::memory_order_relaxed);
+				break;
+			}
+			return errno;
+		}
+
+		if (Read == 0)
+		{
+			return EFAULT;
+		}
+
+		//
+		// Advance past the bytes read, a partial range is continued by the next call
+		//
+
+		SIZE_T Remaining = static_cast<SIZE_T>(Read);
+		while (Remaining && Next < Count)
+		{
+			SIZE_T Left = Reads[Next].Size - Done;
+			if (Remaining < Left)
+			{
+				Done += Remaining;
+				Remaining = 0;
+			}
+			else
+			{
+				Remaining -= Left;
+				Next++;
+				Done = 0;
+			}
+		}
+
+		while (Next < Count && Reads[Next].Size == 0)
+		{
+			Next++;
+		}
+	}
+
+	if (Next == Count)
+	{
+		return 0;
+	}
+	return ReadProcessFile(Memory, Reads + Next, Count - Next, Done);
+#endif
+}
+
+#if !defined(_WIN32)
+static const size_t PROCESS_WRITE_PAGE = 4096;
+
+static DWORD WriteProcessFile(PROCESS_MEMORY& Memory, const PROCESS_WRITE& Write, SIZE_T Done)
+{
+	if (Memory.Memory < 0)
+	{
+		return EPERM;
+	}
+
+	while (Done < Write.Size)
+	{
+		ssize_t Written = pwrite(Memory.Memory, Write.Local + Done, Write.Size - Done,
+			static_cast<off_t>(reinterpret_cast<size_t>(Write.Remote) + Done));
+		if (Written < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return errno;
+		}
+
+		if (Written == 0)
+		{
+			return EFAULT;
+		}
+		Done += Written;
+	}
+	return 0;
+}
+#endif
+
+/*++
+
+Routine Description:
+
+	Writes a batch of ranges of the process, the memory must have been opened writeable
+	On Linux up to PROCESS_READ_BATCH ranges go into one process_vm_writev, which stops at a range it cannot write
+	(process_vm_writev honors page protection): that range is written through /proc/<pid>/mem, which does not,
+	and the batch continues after it. If the kernel or the ptrace policy refuses process_vm_writev, this and every later
+	write of the process uses /proc/<pid>/mem only
+	Every range is attempted, a range that fails does not stop the ones after it
+
+Parameters:
+
+	Memory - The process memory, opened writeable
+	Writes - The ranges to write, each from its own local buffer
+	Count - The number of ranges
+	Results - Optionally receives the outcome of each range, 0 or GetLastError() (errno on Linux)
+
+Return Value:
+
+	DWORD - 0 when every range was written, otherwise the error of the first range that failed
+
+--*/
+DWORD WriteProcessRanges(PROCESS_MEMORY& Memory, const PROCESS_WRITE* Writes, size_t Count, DWORD* Results)
+{
+	DWORD FirstError = 0;
+	auto Complete = [&](size_t Index, DWORD StatusCode)
+	{
+		if (Results)
+		{
+			Results[Index] = StatusCode;
+		}
+
+		if (StatusCode && !FirstError)
+		{
+			FirstError = StatusCode;
+		}
+	};
+
+#if defined(_WIN32)
+	for (size_t Index = 0; Index < Count; Index++)
+	{
+		if (!Memory.Process)
+		{
+			Complete(Index, ERROR_ACCESS_DENIED);
+		}
+		else if (!WriteProcessMemory(Memory.Process, Writes[Index].Remote, Writes[Index].Local, Writes[Index].Size, NULL))
+		{
+			Complete(Index, GetLastError());
+		}
+		else
+		{
+			Complete(Index, 0);
+		}
+	}
+	return FirstError;
+#else
+	pid_t ProcessId = Memory.ProcessId ? static_cast<pid_t>(Memory.ProcessId) : getpid();
+	size_t Next = 0;
+	SIZE_T Done = 0;
+
+	//
+	// Once process_vm_writev faults on a range, the ranges starting in [FileFrom, FileUntil) - the pages of that range - are written
+	// through the file straight away, they share its protection and would fault the same way
+	//
+
+	size_t FileFrom = 0;
+	size_t FileUntil = 0;
+
+	while (Next < Count)
+	{
+		if (Writes[Next].Size == 0)
+		{
+			Complete(Next++, 0);
+			continue;
+		}
+
+		size_t Start = reinterpret_cast<size_t>(Writes[Next].Remote) + Done;
+		if (!Memory.VectorWrites.load(std::memory_order_relaxed) || (Start >= FileFrom && Start < FileUntil))
+		{
+			Complete(Next, WriteProcessFile(Memory, Writes[Next], Done));
+			Next++;
+			Done = 0;
+			continue;
+		}
+
+		iovec Local[PROCESS_READ_BATCH];
+		iovec Remote[PROCESS_READ_BATCH];
+
+		size_t Batch = 0;
+		for (size_t Index = Next; Index < Count && Batch < PROCESS_READ_BATCH; Index++, Batch++)
+		{
+			SIZE_T Skip = (Index == Next) ? Done : 0;
+			Local[Batch].iov_base = const_cast<BYTE*>(Writes[Index].Local) + Skip;
+			Local[Batch].iov_len = Writes[Index].Size - Skip;
+			Remote[Batch].iov_base = static_cast<BYTE*>(Writes[Index].Remote) + Skip;
+			Remote[Batch].iov_len = Writes[Index].Size - Skip;
+		}
+
+		ssize_t Written = process_vm_writev(ProcessId, Local, Batch, Remote, Batch, 0);
+		if (Written < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			if (errno == ENOSYS || errno == EPERM)
+			{
+				Memory.VectorWrites.store(false, std::memory_order_relaxed);
+				continue;
+			}
+		}
+
+		if (Written <= 0)
+		{
+			//
+			// The first range (from Done on) is not writeable through process_vm_writev, write it through the file
+			//
+
+			FileFrom = Start & ~(PROCESS_WRITE_PAGE - 1);
+			FileUntil = ((Start + Writes[Next].Size - Done - 1) | (PROCESS_WRITE_PAGE - 1)) + 1;
+			Complete(Next, WriteProcessFile(Memory, Writes[Next], Done));
+			Next++;
+			Done = 0;
+			continue;
+		}
+
+		//
+		// Advance past the bytes written, a partial range is continued by the next call
+		//
+
+		SIZE_T Remaining = static_cast<SIZE_T>(Written);
+		while (Remaining && Next < Count)
+		{
+			SIZE_T Left = Writes[Next].Size - Done;
+			if (Remaining < Left)
+			{
+				Done += Remaining;
+				Remaining = 0;
+			}
+			else
+			{
+				Remaining -= Left;
+				Complete(Next++, 0);
+				Done = 0;
+			}
+		}
+	}
+	return FirstError;
+#endif
+}
+
+/*++
+
+Routine Description:
+
+	Checks whether the process is still running, reads of a process that exited fail
+
+Parameters:
+
+	Memory - The opened process memory
+
+Return Value:
+
+	bool - true while the process is running, always true for the current process
+
+--*/
+bool IsProcessRunning(PROCESS_MEMORY& Memory)
+{
+	if (IsLocalProcess(Memory))
+	{
+		return true;
+	}
+
+#if defined(_WIN32)
+	DWORD ExitCode = 0;
+	return GetExitCodeProcess(Memory.Process, &ExitCode) && ExitCode == STILL_ACTIVE;
+#else
+	return kill(static_cast<pid_t>(Memory.ProcessId), 0) == 0 || errno == EPERM;
+#endif
+}
+
+void CloseProcessMemory(PROCESS_MEMORY& Memory)
+{
+#if defined(_WIN32)
+	if (Memory.Process && Memory.Process != GetCurrentProcess())
+	{
+		CloseHandle(Memory.Process);
+	}
+	Memory.Process = NULL;
+#else
+	if (Memory.Memory >= 0)
+	{
+		close(Memory.Memory);
+	}
+	Memory.Memory = -1;
+#endif
+}
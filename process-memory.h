@@ -0,0 +1,77 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#pragma once
+#include <atomic>
+#include "platform.h"
+
+//
+// Process Memory
+// Reads the memory of the scanned process. In-process (ProcessId 0) the scanner dereferences the pages directly,
+// out-of-process it reads them in batches: process_vm_readv with many iovecs per call on Linux, falling back to
+// pread on /proc/<pid>/mem when it is not permitted, and ReadProcessMemory per range on Windows (which has no batched read)
+// Opened writeable it also writes ranges: on Linux in batches with process_vm_writev, a range it cannot write (a read-only page)
+// is written with pwrite on /proc/<pid>/mem (/proc/self/mem in-process) instead, on Windows with WriteProcessMemory per range
+// /proc/<pid>/mem and WriteProcessMemory write read-only pages too, as a debugger does
+//
+
+#define PROCESS_READ_BATCH 1024
+
+typedef struct _PROCESS_READ
+{
+	PVOID Remote;
+	BYTE* Local;
+	SIZE_T Size;
+} PROCESS_READ;
+
+typedef struct _PROCESS_WRITE
+{
+	PVOID Remote;
+	const BYTE* Local;
+	SIZE_T Size;
+} PROCESS_WRITE;
+
+typedef struct _PROCESS_MEMORY
+{
+	DWORD ProcessId;
+#if defined(_WIN32)
+	HANDLE Process;
+#else
+	int Memory;
+	std::atomic<bool> VectorReads;
+	std::atomic<bool> VectorWrites;
+#endif
+} PROCESS_MEMORY;
+
+DWORD OpenProcessMemory(PROCESS_MEMORY& Memory, DWORD ProcessId, bool Writeable = false);
+DWORD ReadProcessRanges(PROCESS_MEMORY& Memory, const PROCESS_READ* Reads, size_t Count);
+DWORD WriteProcessRanges(PROCESS_MEMORY& Memory, const PROCESS_WRITE* Writes, size_t Count, DWORD* Results = NULL);
+bool IsProcessRunning(PROCESS_MEMORY& Memory);
+void CloseProcessMemory(PROCESS_MEMORY& Memory);
+
+inline bool IsLocalProcess(const PROCESS_MEMORY& Memory)
+{
+	return Memory.ProcessId == 0;
+}
@@ -0,0 +1,332 @@
+#include "pch.h"
+#include "regions.h"
+
+#if defined(__linux__)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+
+//
+// Initial size of the maps buffer, it is grown (doubled) only when a process has more mappings than fit and then reused
+//
+
+#define REGION_MAPS_INITIAL_SIZE (64 * 1024)
+
+/*++
+
+Routine Description:
+
+	Reads all of /proc/<pid>/maps into the enumerator's buffer
+	procfs produces the maps text a page at a time, so one read() cannot return it all; reads continue into the same buffer until EOF
+
+Parameters:
+
+	Enumerator - The enumerator owning the buffer
+	ProcessId - The process, 0 for the current process
+	Length - Receives the length of the text read
+
+Return Value:
+
+	DWORD - 0 or errno
+
+--*/
+static DWORD ReadProcessMaps(REGION_ENUMERATOR& Enumerator, DWORD ProcessId, size_t& Length)
+{
+	char Path[64];
+	if (ProcessId)
+	{
+		snprintf(Path, sizeof(Path), "/proc/%u/maps", ProcessId);
+	}
+	else
+	{
+		snprintf(Path, sizeof(Path), "/proc/self/maps");
+	}
+
+	int Maps = open(Path, O_RDONLY | O_CLOEXEC);
+	if (Maps < 0)
+	{
+		return errno;
+	}
+
+	if (Enumerator.Buffer.empty())
+	{
+		Enumerator.Buffer.resize(REGION_MAPS_INITIAL_SIZE);
+	}
+
+	Length = 0;
+	for (;;)
+	{
+		if (Length == Enumerator.Buffer.size())
+		{
+			Enumerator.Buffer.resize(Enumerator.Buffer.size() * 2);
+		}
+
+		ssize_t Read = read(Maps, Enumerator.Buffer.data() + Length, Enumerator.Buffer.size() - Length);
+		if (Read < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			DWORD StatusCode = errno;
+			close(Maps);
+			return StatusCode;
+		}
+
+		if (Read == 0)
+		{
+			break;
+		}
+		Length += Read;
+	}
+
+	close(Maps);
+	return 0;
+}
+
+/*++
+
+Routine Description:
+
+	Parses a hexadecimal field of a maps line in place
+
+Parameters:
+
+	Cursor - The start of the field, receives the position after it
+	End - The end of the text
+
+Return Value:
+
+	size_t - The value of the field
+
+--*/
+static size_t ParseMapsHex(const char*& Cursor, const char* End)
+{
+	size_t Value = 0;
+	for (; Cursor < End; Cursor++)
+	{
+		char Digit = *Cursor;
+		if (Digit >= '0' && Digit <= '9')
+		{
+			Value = (Value << 4) | static_cast<size_t>(Digit - '0');
+		}
+		else if (Digit >= 'a' && Digit <= 'f')
+		{
+			Value = (Value << 4) | static_cast<size_t>(Digit - 'a' + 10);
+		}
+		else
+		{
+			break;
+		}
+	}
+	return Value;
+}
+
+static const char* SkipMapsField(const char* Cursor, const char* End)
+{
+	while (Cursor < End && *Cursor != ' ' && *Cursor != '\n')
+	{
+		Cursor++;
+	}
+	while (Cursor < End && *Cursor == ' ')
+	{
+		Cursor++;
+	}
+	return Cursor;
+}
+
+// the path of the main executable of a process (0 for the current one), from its /proc/<pid>/exe link, not terminated
+static DWORD ReadExecutablePath(DWORD ProcessId, char* Path, size_t Size, size_t& Length)
+{
+	char Executable[64];
+	if (ProcessId)
+	{
+		snprintf(Executable, sizeof(Executable), "/proc/%u/exe", ProcessId);
+	}
+	else
+	{
+		snprintf(Executable, sizeof(Executable), "/proc/self/exe");
+	}
+
+	ssize_t Linked = readlink(Executable, Path, Size - 1);
+	if (Linked < 0)
+	{
+		return errno;
+	}
+	Length = static_cast<size_t>(Linked);
+	return 0;
+}
+
+/*++
+
+Routine Description:
+
+	Linux backend, parses /proc/<pid>/maps in place without allocating (after the buffer reached the size of the maps)
+	Each line is "start-end perms offset dev inode path", the lines of the module are the ones whose path is the module name,
+	or whose file name is, and the module base is the lowest address mapped from it
+	A file name alone must name a single file: when the lines it matches were mapped from two paths (a library of the same name
+	in another directory) the module is ambiguous and nothing is enumerated
+
+--*/
+DWORD EnumerateModuleRegions(REGION_ENUMERATOR& Enumerator, DWORD ProcessId, LPCWSTR ModuleName, PVOID& ModuleBase, std::vector<MEM_REGION>& Regions,
+	REGION_FILTER Filter)
+{
+	Regions.clear();
+	ModuleBase = NULL;
+
+	//
+	// Resolve the module name to a narrow path, NULL/empty is the main executable
+	//
+
+	char Name[PATH_MAX];
+	size_t NameLength;
+	if (!ModuleName || !*ModuleName)
+	{
+		DWORD StatusCode = ReadExecutablePath(ProcessId, Name, sizeof(Name), NameLength);
+		if (StatusCode)
+		{
+			return StatusCode;
+		}
+	}
+	else
+	{
+		NameLength = wcstombs(Name, ModuleName, sizeof(Name) - 1);
+		if (NameLength == static_cast<size_t>(-1))
+		{
+			return ERROR_INVALID_PARAMETER;
+		}
+	}
+	Name[NameLength] = '\0';
+
+	size_t Length = 0;
+	DWORD StatusCode = ReadProcessMaps(Enumerator, ProcessId, Length);
+	if (StatusCode)
+	{
+		return StatusCode;
+	}
+
+	const char* Cursor = Enumerator.Buffer.data();
+	const char* End = Cursor + Length;
+	const char* ModulePath = NULL;
+	size_t ModulePathLength = 0;
+	while (Cursor < End)
+	{
+		const char* LineEnd = static_cast<const char*>(memchr(Cursor, '\n', End - Cursor));
+		if (!LineEnd)
+		{
+			LineEnd = End;
+		}
+
+		//
+		// Either match ends the line with the module name, so every other mapping is rejected without parsing its fields
+		//
+
+		if (static_cast<size_t>(LineEnd - Cursor) <= NameLength || memcmp(LineEnd - NameLength, Name, NameLength))
+		{
+			Cursor = LineEnd + 1;
+			continue;
+		}
+
+		//
+		// start-end perms, then skip offset, dev and inode to the path (which may contain spaces, so it is the rest of the line)
+		//
+
+		size_t Start = ParseMapsHex(Cursor, LineEnd);
+		Cursor++;
+		size_t Stop = ParseMapsHex(Cursor, LineEnd);
+		Cursor = SkipMapsField(Cursor, LineEnd);
+		const char* Permissions = Cursor;
+		Cursor = SkipMapsField(Cursor, LineEnd);
+		Cursor = SkipMapsField(Cursor, LineEnd);
+		Cursor = SkipMapsField(Cursor, LineEnd);
+		Cursor = SkipMapsField(Cursor, LineEnd);
+
+		const char* Path = Cursor;
+		size_t PathLength = LineEnd - Path;
+		const char* FileName = static_cast<const char*>(memrchr(Path, '/', PathLength));
+		FileName = FileName ? FileName + 1 : Path;
+		size_t FileNameLength = LineEnd - FileName;
+
+		bool Matches = PathLength && LineEnd - Permissions > 4 &&
+			((PathLength == NameLength && !memcmp(Path, Name, NameLength)) ||
+			(FileNameLength == NameLength && !memcmp(FileName, Name, NameLength)));
+
+		//
+		// Every line of the module is mapped from the path of the first line matched, the buffer holds it until the walk ends
+		//
+
+		if (Matches && ModulePath && (PathLength != ModulePathLength || memcmp(Path, ModulePath, PathLength)))
+		{
+			Regions.clear();
+			ModuleBase = NULL;
+			return ERROR_INVALID_PARAMETER;
+		}
+
+		if (Matches)
+		{
+			ModulePath = Path;
+			ModulePathLength = PathLength;
+			if (!ModuleBase || Start < reinterpret_cast<size_t>(ModuleBase))
+			{
+				ModuleBase = reinterpret_cast<PVOID>(Start);
+			}
+
+			//
+			// Same filters as the Win32 walk, r-x is PAGE_EXECUTE_READ and r-- is PAGE_READONLY, rwx is PAGE_EXECUTE_READWRITE and rw- is
+			// PAGE_READWRITE (a private mapping is copy on write, but it is reported as writeable the same way a written PAGE_WRITECOPY page is)
+			//
+
+			bool Writeable = Permissions[1] == 'w';
+			if (Permissions[0] == 'r' && Writeable == (Filter == RegionsWriteable))
+			{
+				DWORD Protect = Writeable ? (Permissions[2] == 'x' ? PAGE_EXECUTE_READWRITE : PAGE_READWRITE) :
+					(Permissions[2] == 'x' ? PAGE_EXECUTE_READ : PAGE_READONLY);
+				Regions.push_back({ reinterpret_cast<PVOID>(Start), Stop - Start, Protect });
+			}
+		}
+
+		Cursor = LineEnd + 1;
+	}
+
+	if (!ModuleBase)
+	{
+		return ERROR_FILE_NOT_FOUND;
+	}
+	return 0;
+}
+
+/*++
+
+Routine Description:
+
+	Linux backend, the file name of the /proc/<pid>/exe link, which EnumerateModuleRegions matches the same as the full path
+
+--*/
+DWORD QueryExecutableName(DWORD ProcessId, std::wstring& Name)
+{
+	char Path[PATH_MAX];
+	size_t Length = 0;
+	DWORD StatusCode = ReadExecutablePath(ProcessId, Path, sizeof(Path), Length);
+	if (StatusCode)
+	{
+		return StatusCode;
+	}
+	Path[Length] = '\0';
+
+	const char* FileName = strrchr(Path, '/');
+	FileName = FileName ? FileName + 1 : Path;
+	size_t NameLength = mbstowcs(NULL, FileName, 0);
+	if (NameLength == static_cast<size_t>(-1))
+	{
+		return ERROR_INVALID_PARAMETER;
+	}
+
+	Name.resize(NameLength + 1);
+	Name.resize(mbstowcs(&Name[0], FileName, Name.size()));
+	return 0;
+}
+#endif
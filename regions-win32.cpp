@@ -0,0 +1,160 @@
+#include "pch.h"
+#include "regions.h"
+
+#if defined(_WIN32)
+#include <iostream>
+#include <psapi.h>
+
+/*++
+
+Routine Description:
+
+	Finds a module of another process by its base name (case insensitive), or its first module (the executable) for an empty name
+
+Return Value:
+
+	HMODULE - The module, or NULL with the last error set
+
+--*/
+static HMODULE FindRemoteModule(HANDLE Process, LPCWSTR ModuleName)
+{
+	HMODULE Modules[1024];
+	DWORD Needed = 0;
+	if (!K32EnumProcessModules(Process, Modules, sizeof(Modules), &Needed))
+	{
+		return NULL;
+	}
+
+	DWORD Count = (Needed < sizeof(Modules) ? Needed : sizeof(Modules)) / sizeof(HMODULE);
+	if (!ModuleName || !*ModuleName)
+	{
+		return Count ? Modules[0] : NULL;
+	}
+
+	for (DWORD Index = 0; Index < Count; Index++)
+	{
+		WCHAR BaseName[MAX_PATH];
+		if (K32GetModuleBaseNameW(Process, Modules[Index], BaseName, MAX_PATH) && !_wcsicmp(BaseName, ModuleName))
+		{
+			return Modules[Index];
+		}
+	}
+
+	SetLastError(ERROR_MOD_NOT_FOUND);
+	return NULL;
+}
+
+/*++
+
+Routine Description:
+
+	Win32 backend, walks the module image with VirtualQueryEx using the image size from K32GetModuleInformation
+	The current process finds the module with GetModuleHandle, another process by enumerating its modules
+
+--*/
+DWORD EnumerateModuleRegions(REGION_ENUMERATOR& Enumerator, DWORD ProcessId, LPCWSTR ModuleName, PVOID& ModuleBase, std::vector<MEM_REGION>& Regions,
+	REGION_FILTER Filter)
+{
+	Regions.clear();
+
+	HANDLE Process = GetCurrentProcess();
+	if (ProcessId)
+	{
+		Process = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, ProcessId);
+		if (!Process)
+		{
+			DWORD StatusCode = GetLastError();
+			std::cerr << "OpenProcess encountered an error: " << StatusCode << std::endl;
+			return StatusCode;
+		}
+	}
+
+	//
+	// Get the module handle (HMODULE) used in getting module information
+	//
+
+	HMODULE Module = ProcessId ? FindRemoteModule(Process, ModuleName) : GetModuleHandle(ModuleName && *ModuleName ? ModuleName : NULL);
+	MODULEINFO ModuleInformation;
+
+	//
+	// Get information about the module returned from GetModuleHandle
+	// Specifically the size of the module is the information required
+	// Size is required for calculating when to stop page iteration
+	//
+
+	if (!Module || !K32GetModuleInformation(Process, Module, &ModuleInformation, sizeof(ModuleInformation)))
+	{
+		//
+		// K32GetModuleInformation failed with FALSE, return the last WINAPI error
+		//
+
+		DWORD StatusCode = GetLastError();
+		std::cerr << "K32GetModuleInformation encountered an error: " << StatusCode << std::endl;
+		if (ProcessId)
+		{
+			CloseHandle(Process);
+		}
+		return StatusCode;
+	}
+
+	//
+	// Initial query on the first memory page of the executable module
+	//
+
+	MEMORY_BASIC_INFORMATION BasicInformation = { 0 };
+	VirtualQueryEx(Process, Module, &BasicInformation, sizeof(BasicInformation));
+	ModuleBase = BasicInformation.BaseAddress;
+
+	for (size_t PageIter = reinterpret_cast<size_t>(BasicInformation.BaseAddress);
+		PageIter < (reinterpret_cast<size_t>(BasicInformation.BaseAddress) + ModuleInformation.SizeOfImage);  PageIter += BasicInformation.RegionSize)
+	{
+		VirtualQueryEx(Process, reinterpret_cast<PVOID>(PageIter), &BasicInformation, sizeof(BasicInformation));
+		if ((size_t)BasicInformation.BaseAddress < (size_t)Module + ModuleInformation.SizeOfImage)
+		{
+			bool Writeable = BasicInformation.Protect == PAGE_READWRITE || BasicInformation.Protect == PAGE_WRITECOPY ||
+				BasicInformation.Protect == PAGE_EXECUTE_READWRITE;
+			bool Protected = BasicInformation.Protect == PAGE_EXECUTE_READ || BasicInformation.Protect == PAGE_READONLY;
+			if (Filter == RegionsWriteable ? Writeable : Protected)
+			{
+				Regions.push_back({ BasicInformation.BaseAddress, BasicInformation.RegionSize, BasicInformation.Protect });
+			}
+		}
+	}
+
+	if (ProcessId)
+	{
+		CloseHandle(Process);
+	}
+	return 0;
+}
+/*++
+
+Routine Description:
+
+	Win32 backend, the base name of the first module of the process (the executable), as FindRemoteModule matches it
+
+--*/
+DWORD QueryExecutableName(DWORD ProcessId, std::wstring& Name)
+{
+	HANDLE Process = ProcessId ? OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, ProcessId) : GetCurrentProcess();
+	if (!Process)
+	{
+		return GetLastError();
+	}
+
+	WCHAR BaseName[MAX_PATH];
+	DWORD Length = K32GetModuleBaseNameW(Process, NULL, BaseName, MAX_PATH);
+	DWORD StatusCode = Length ? 0 : GetLastError();
+	if (ProcessId)
+	{
+		CloseHandle(Process);
+	}
+
+	if (StatusCode)
+	{
+		return StatusCode;
+	}
+	Name.assign(BaseName, Length);
+	return 0;
+}
+#endif
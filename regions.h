@@ -0,0 +1,109 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "platform.h"
+
+//
+// A registered region of a module, only the fields of MEMORY_BASIC_INFORMATION the scanner uses
+// Protect is always a PAGE_* value, the Linux backend maps r-x to PAGE_EXECUTE_READ and r-- to PAGE_READONLY
+//
+
+struct MEM_REGION
+{
+	PVOID BaseAddress;
+	SIZE_T RegionSize;
+	DWORD Protect;
+};
+
+//
+// State reused across enumerations, so enumerating again (e.g. on every rescan) does not allocate
+// The Linux backend reads /proc/<pid>/maps into Buffer and parses it in place
+//
+
+struct REGION_ENUMERATOR
+{
+	std::vector<char> Buffer;
+};
+
+//
+// Which regions of a module are enumerated
+// RegionsProtected - PAGE_EXECUTE_READ and PAGE_READONLY, the code and constants the module is not expected to write
+// RegionsWriteable - PAGE_READWRITE, PAGE_WRITECOPY and PAGE_EXECUTE_READWRITE, the data the module writes itself
+//
+
+enum REGION_FILTER
+{
+	RegionsProtected,
+	RegionsWriteable
+};
+
+/*++
+
+Routine Description:
+
+	Enumerates the regions of a module that pass Filter, by default the PAGE_EXECUTE_READ and PAGE_READONLY ones
+	Implemented by regions-win32.cpp (VirtualQueryEx walk) and regions-linux.cpp (/proc/<pid>/maps)
+
+Parameters:
+
+	Enumerator - The reusable enumeration state
+	ProcessId - The process the module is loaded in, 0 for the current process
+	ModuleName - The name of the module, or NULL/empty for the main executable
+		On Linux it is matched against the full path of the mapping, or its file name alone when only one path has that file name
+	ModuleBase - Receives the base address of the module
+	Regions - Receives the regions, in ascending address order
+	Filter - The regions to enumerate, the base is found either way
+
+Return Value:
+
+	DWORD - 0 or a platform error code (GetLastError() on Windows, errno elsewhere), ERROR_INVALID_PARAMETER on Linux when a file
+		name matches mappings of several paths
+
+--*/
+DWORD EnumerateModuleRegions(REGION_ENUMERATOR& Enumerator, DWORD ProcessId, LPCWSTR ModuleName, PVOID& ModuleBase, std::vector<MEM_REGION>& Regions,
+	REGION_FILTER Filter = RegionsProtected);
+
+/*++
+
+Routine Description:
+
+	Retrieves the name of the main executable of a process, in the form EnumerateModuleRegions matches as a module name
+	Implemented by regions-win32.cpp (its base name) and regions-linux.cpp (the file name of /proc/<pid>/exe)
+
+Parameters:
+
+	ProcessId - The process, 0 for the current process
+	Name - Receives the name
+
+Return Value:
+
+	DWORD - 0 or a platform error code (GetLastError() on Windows, errno elsewhere)
+
+--*/
+DWORD QueryExecutableName(DWORD ProcessId, std::wstring& Name);
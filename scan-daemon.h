@@ -0,0 +1,331 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "page-scanner.h"
+
+//
+// Scan Daemon
+// One scanner watching any number of processes: each target has its own page table and sweep state, and a shared pool of workers
+// sweeps them in slices. Runnable targets are served round robin with a deficit of ScanDaemonQuantum bytes per turn, so a huge
+// target is swept over many turns and cannot starve small ones, and a target with a finished sweep sleeps ScanDaemonInterval
+// before its next one. Workers with nothing runnable block until the next target is due, none of them spin
+// The workers share one governor (governor.h): a turn's quantum is at most a governor slice, and no turn starts before the budget
+// clock, so all the workers together stay within ScanDaemonCpuBudget of one core
+//
+
+const SIZE_T ScanDaemonQuantum = 4 * 1024 * 1024;
+const std::chrono::milliseconds ScanDaemonInterval(100);
+const double ScanDaemonCpuBudget = ScanCpuBudget;
+
+template <class HashPolicy>
+struct SCAN_TARGET
+{
+	PROCESS_MEMORY Memory;
+	PAGE_TABLE<HashPolicy> PageSet;
+	SWEEP_STATE Sweep;
+	long long Deficit;
+	std::chrono::steady_clock::time_point Due;
+};
+
+template <class HashPolicy>
+struct SCAN_DAEMON
+{
+	std::mutex Lock;
+	std::condition_variable Wake;
+	std::condition_variable Drained;
+	std::deque<SCAN_TARGET<HashPolicy>*> Runnable;
+	std::vector<SCAN_TARGET<HashPolicy>*> Sleeping;
+	size_t TargetCount = 0;
+	bool Stopping = false;
+	SCAN_GOVERNOR Governor;
+	std::vector<std::thread> Workers;
+};
+
+template <class HashPolicy>
+void DestroyScanTarget(SCAN_TARGET<HashPolicy>* Target)
+{
+	CloseSweepState(Target->Sweep);
+	DestroySnapshotArena(Target->PageSet.Arena);
+	CloseProcessMemory(Target->Memory);
+	delete Target;
+}
+
+/*++
+
+Routine Description:
+
+	A worker of the scan daemon, runs slices of the runnable targets until the daemon stops
+	A target is only ever swept by the worker that took it off the run queue, so its state needs no locking
+
+Parameters:
+
+	Daemon - The scan daemon
+
+Return Value:
+
+	None
+
+--*/
+template <class HashPolicy>
+void ScanDaemonWorker(SCAN_DAEMON<HashPolicy>& Daemon)
+{
+	std::unique_lock<std::mutex> Guard(Daemon.Lock);
+	while (!Daemon.Stopping)
+	{
+		//
+		// Targets whose interval elapsed join the back of the run queue, the earliest of the others bounds the wait
+		//
+
+		std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point NextDue = std::chrono::steady_clock::time_point::max();
+		for (size_t Index = 0; Index < Daemon.Sleeping.size();)
+		{
+			SCAN_TARGET<HashPolicy>* Target = Daemon.Sleeping[Index];
+			if (Target->Due <= Now)
+			{
+				Daemon.Runnable.push_back(Target);
+				Daemon.Sleeping[Index] = Daemon.Sleeping.back();
+				Daemon.Sleeping.pop_back();
+				continue;
+			}
+			NextDue = (std::min)(NextDue, Target->Due);
+			Index++;
+		}
+
+		if (Daemon.Runnable.empty())
+		{
+			if (NextDue == std::chrono::steady_clock::time_point::max())
+			{
+				Daemon.Wake.wait(Guard);
+			}
+			else
+			{
+				Daemon.Wake.wait_until(Guard, NextDue);
+			}
+			continue;
+		}
+
+		//
+		// The slices of the workers are charged to the shared governor, a turn waits for the budget the previous ones spent
+		//
+
+		if (Daemon.Governor.BudgetClock > Now)
+		{
+			Daemon.Wake.wait_until(Guard, Daemon.Governor.BudgetClock);
+			continue;
+		}
+
+		SCAN_TARGET<HashPolicy>* Target = Daemon.Runnable.front();
+		Daemon.Runnable.pop_front();
+		SIZE_T Quantum = (std::min)(ScanDaemonQuantum, GovernorSliceBytes(Daemon.Governor));
+		Guard.unlock();
+
+		//
+		// Deficit round robin: each turn adds a quantum, the slice spends it, and a slice overshooting it (one large region)
+		// leaves the target in debt, sitting out turns until it is repaid
+		//
+
+		SWEEP_RESULT Result = SweepPending;
+		SIZE_T Hashed = 0;
+		GOVERNOR_TIME SliceStart = std::chrono::steady_clock::now();
+		Target->Deficit += static_cast<long long>(Quantum);
+		if (Target->Deficit > 0)
+		{
+			Result = SweepPageSlice(Target->PageSet, Target->Memory, Target->Sweep, static_cast<SIZE_T>(Target->Deficit), Hashed);
+			Target->Deficit -= static_cast<long long>(Hashed);
+		}
+		GOVERNOR_TIME SliceEnd = std::chrono::steady_clock::now();
+		size_t SliceThreads = Target->Sweep.SliceThreads;
+
+		if (Result == SweepExited)
+		{
+			DestroyScanTarget(Target);
+		}
+
+		Guard.lock();
+		GovernorChargeSlice(Daemon.Governor, SliceStart, SliceEnd, Hashed, SliceThreads);
+		if (Result == SweepPending)
+		{
+			Daemon.Runnable.push_back(Target);
+		}
+		else if (Result == SweepComplete)
+		{
+			//
+			// An idle target keeps its debt but not its credit, as in deficit round robin when a flow's queue empties
+			//
+
+			Target->Deficit = (std::min)(Target->Deficit, 0LL);
+			Target->Due = std::chrono::steady_clock::now() + ScanDaemonInterval;
+			Daemon.Sleeping.push_back(Target);
+		}
+		else if (!--Daemon.TargetCount)
+		{
+			Daemon.Drained.notify_all();
+		}
+	}
+}
+
+/*++
+
+Routine Description:
+
+	Starts the workers of the scan daemon, targets are added with AddScanTarget before or after
+
+Parameters:
+
+	Daemon - The scan daemon
+	ThreadCount - The number of workers, 0 for one per hardware thread
+
+Return Value:
+
+	None
+
+--*/
+template <class HashPolicy>
+void StartScanDaemon(SCAN_DAEMON<HashPolicy>& Daemon, size_t ThreadCount = 0)
+{
+	if (!ThreadCount)
+	{
+		ThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	}
+
+	//
+	// Targets are paced by ScanDaemonInterval rather than a sweep period
+	//
+
+	StartGovernor(Daemon.Governor, ScanDaemonCpuBudget, std::chrono::nanoseconds::zero());
+	Daemon.Stopping = false;
+	for (size_t ThreadIndex = 0; ThreadIndex < ThreadCount; ThreadIndex++)
+	{
+		Daemon.Workers.emplace_back(ScanDaemonWorker<HashPolicy>, std::ref(Daemon));
+	}
+}
+
+/*++
+
+Routine Description:
+
+	Registers the pages of a module of a process and makes the process a target of the scan daemon
+	The pages are captured on the calling thread, the daemon keeps sweeping its other targets meanwhile
+
+Parameters:
+
+	Daemon - The scan daemon
+	ProcessId - The process to scan, 0 for the current process
+	ModuleName - The name of the module, empty for the main executable
+
+Return Value:
+
+	DWORD - 0 or the error that prevented the module from being registered
+
+--*/
+template <class HashPolicy>
+DWORD AddScanTarget(SCAN_DAEMON<HashPolicy>& Daemon, DWORD ProcessId, LPWSTR ModuleName)
+{
+	SCAN_TARGET<HashPolicy>* Target = new SCAN_TARGET<HashPolicy>();
+
+	DWORD StatusCode = OpenProcessMemory(Target->Memory, ProcessId);
+	if (StatusCode)
+	{
+		std::cerr << "OpenProcessMemory encountered an error: " << StatusCode << std::endl;
+		delete Target;
+		return StatusCode;
+	}
+
+	StatusCode = GetModulePages(Target->Memory, ModuleName, Target->PageSet);
+	if (StatusCode)
+	{
+		DestroySnapshotArena(Target->PageSet.Arena);
+		CloseProcessMemory(Target->Memory);
+		delete Target;
+		return StatusCode;
+	}
+
+	OpenSweepState(Target->Sweep, Target->Memory);
+	Target->Deficit = 0;
+
+	std::lock_guard<std::mutex> Guard(Daemon.Lock);
+	Daemon.TargetCount++;
+	Daemon.Runnable.push_back(Target);
+	Daemon.Wake.notify_one();
+	return 0;
+}
+
+// blocks until every target of the scan daemon exited
+template <class HashPolicy>
+void WaitScanDaemon(SCAN_DAEMON<HashPolicy>& Daemon)
+{
+	std::unique_lock<std::mutex> Guard(Daemon.Lock);
+	Daemon.Drained.wait(Guard, [&]() { return Daemon.TargetCount == 0; });
+}
+
+/*++
+
+Routine Description:
+
+	Stops the workers of the scan daemon, then releases its remaining targets
+
+Parameters:
+
+	Daemon - The scan daemon
+
+Return Value:
+
+	None
+
+--*/
+template <class HashPolicy>
+void StopScanDaemon(SCAN_DAEMON<HashPolicy>& Daemon)
+{
+	{
+		std::lock_guard<std::mutex> Guard(Daemon.Lock);
+		Daemon.Stopping = true;
+		Daemon.Wake.notify_all();
+	}
+
+	for (std::thread& Worker : Daemon.Workers)
+	{
+		Worker.join();
+	}
+	Daemon.Workers.clear();
+	StopGovernor(Daemon.Governor);
+
+	for (SCAN_TARGET<HashPolicy>* Target : Daemon.Runnable)
+	{
+		DestroyScanTarget(Target);
+	}
+	for (SCAN_TARGET<HashPolicy>* Target : Daemon.Sleeping)
+	{
+		DestroyScanTarget(Target);
+	}
+	Daemon.Runnable.clear();
+	Daemon.Sleeping.clear();
+	Daemon.TargetCount = 0;
+}
@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "snapshot-arena.h"
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+//
+// Snapshots are aligned to a cache line, region sizes are page multiples so in practice they are packed back to back
+//
+
+#define SNAPSHOT_ALIGNMENT 64
+
+/*++
+
+Routine Description:
+
+	Reserves and commits the arena in a single VirtualAlloc (mmap on Linux), page aligned
+	With UseLargePages the arena is first attempted with MEM_LARGE_PAGES (fewer TLB misses during deep compares),
+	which requires SeLockMemoryPrivilege, falling back to regular pages when it is not held
+	On Linux the first attempt is MAP_HUGETLB, which requires reserved huge pages, the fallback asks for transparent huge pages instead
+
+Parameters:
+
+	Arena - The arena to create, must not already be created
+	Size - The total size of the snapshots the arena will hold
+	UseLargePages - Attempt a large page backed arena
+
+Return Value:
+
+	DWORD - 0 or GetLastError() indicating a WINAPI error (errno on Linux)
+
+--*/
+DWORD CreateSnapshotArena(SNAPSHOT_ARENA& Arena, SIZE_T Size, bool UseLargePages)
+{
+	Arena = { 0 };
+
+	if (Size == 0)
+	{
+		return 0;
+	}
+
+#if defined(_WIN32)
+	if (UseLargePages)
+	{
+		SIZE_T LargePageSize = GetLargePageMinimum();
+		if (LargePageSize)
+		{
+			SIZE_T LargeSize = (Size + LargePageSize - 1) & ~(LargePageSize - 1);
+			Arena.Base = static_cast<BYTE*>(VirtualAlloc(NULL, LargeSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+			if (Arena.Base)
+			{
+				Arena.Size = LargeSize;
+				Arena.LargePages = true;
+				return 0;
+			}
+		}
+	}
+
+	Arena.Base = static_cast<BYTE*>(VirtualAlloc(NULL, Size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+	if (!Arena.Base)
+	{
+		return GetLastError();
+	}
+#else
+	if (UseLargePages)
+	{
+		const SIZE_T LargePageSize = 2 * 1024 * 1024;
+		SIZE_T LargeSize = (Size + LargePageSize - 1) & ~(LargePageSize - 1);
+		void* Base = mmap(NULL, LargeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (Base != MAP_FAILED)
+		{
+			Arena.Base = static_cast<BYTE*>(Base);
+			Arena.Size = LargeSize;
+			Arena.LargePages = true;
+			return 0;
+		}
+	}
+
+	void* Base = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (Base == MAP_FAILED)
+	{
+		return errno;
+	}
+	Arena.Base = static_cast<BYTE*>(Base);
+
+	if (UseLargePages)
+	{
+		madvise(Base, Size, MADV_HUGEPAGE);
+	}
+#endif
+
+	Arena.Size = Size;
+	return 0;
+}
+
+/*++
+
+Routine Description:
+
+	Bump allocates a snapshot from the arena
+
+Parameters:
+
+	Arena - The arena to allocate from
+	Size - The size of the snapshot
+
+Return Value:
+
+	BYTE* - The snapshot storage, or NULL when the arena is exhausted
+
+--*/
+BYTE* AllocateSnapshot(SNAPSHOT_ARENA& Arena, SIZE_T Size)
+{
+	SIZE_T Offset = (Arena.Used + SNAPSHOT_ALIGNMENT - 1) & ~static_cast<SIZE_T>(SNAPSHOT_ALIGNMENT - 1);
+	if (!Arena.Base || Offset > Arena.Size || Size > Arena.Size - Offset)
+	{
+		return NULL;
+	}
+
+	Arena.Used = Offset + Size;
+	return Arena.Base + Offset;
+}
+
+void DestroySnapshotArena(SNAPSHOT_ARENA& Arena)
+{
+	if (Arena.Base)
+	{
+#if defined(_WIN32)
+		VirtualFree(Arena.Base, 0, MEM_RELEASE);
+#else
+		munmap(Arena.Base, Arena.Size);
+#endif
+	}
+	Arena = { 0 };
+}
@@ -0,0 +1,44 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+#include "platform.h"
+
+//
+// Snapshot Arena
+// One reservation holding every region snapshot back to back, instead of one heap allocation per region
+// Snapshots are bump allocated and never freed individually, the arena is released as a whole
+//
+
+typedef struct _SNAPSHOT_ARENA
+{
+	BYTE* Base;
+	SIZE_T Size;
+	SIZE_T Used;
+	bool LargePages;
+} SNAPSHOT_ARENA;
+
+DWORD CreateSnapshotArena(SNAPSHOT_ARENA& Arena, SIZE_T Size, bool UseLargePages);
+BYTE* AllocateSnapshot(SNAPSHOT_ARENA& Arena, SIZE_T Size);
+void DestroySnapshotArena(SNAPSHOT_ARENA& Arena);
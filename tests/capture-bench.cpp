@@ -0,0 +1,96 @@
+#include "pch.h"
+#include "page-scanner.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+//
+// Capture throughput: registers 256 MiB of this process's memory as a page table, as a mix of single pages and 1 MiB regions,
+// and times CaptureSnapshots in-process (direct copies) and through this process's own id (the batched out-of-process reads)
+//
+
+static const SIZE_T PageSize = 4096;
+static const size_t SmallRegions = 4096;
+static const size_t LargeRegions = 240;
+static const SIZE_T LargeRegionSize = 1024 * 1024;
+static const int Rounds = 4;
+
+static DWORD CurrentProcessId()
+{
+#if defined(_WIN32)
+	return GetCurrentProcessId();
+#else
+	return static_cast<DWORD>(getpid());
+#endif
+}
+
+static bool MeasureCapture(const char* Name, DWORD ProcessId, BYTE* Buffer)
+{
+	PROCESS_MEMORY Memory;
+	DWORD StatusCode = OpenProcessMemory(Memory, ProcessId);
+	if (StatusCode)
+	{
+		printf("FAIL: %s: OpenProcessMemory: %lu\n", Name, static_cast<unsigned long>(StatusCode));
+		return false;
+	}
+
+	SIZE_T TotalBytes = SmallRegions * PageSize + LargeRegions * LargeRegionSize;
+	double Seconds = 0;
+	for (int Round = 0; Round < Rounds; Round++)
+	{
+		PAGE_TABLE<ScanHashPolicy> PageSet = {};
+		if (CreateSnapshotArena(PageSet.Arena, TotalBytes, false))
+		{
+			printf("FAIL: %s: CreateSnapshotArena\n", Name);
+			return false;
+		}
+
+		//
+		// The small regions are every other page of the first 2 * SmallRegions pages, so no two of them are adjacent
+		//
+
+		PageSet.Reserve(SmallRegions + LargeRegions);
+		for (size_t Region = 0; Region < SmallRegions + LargeRegions; Region++)
+		{
+			MEM_REGION Page = {};
+			Page.BaseAddress = Region < SmallRegions ? Buffer + Region * 2 * PageSize : Buffer + SmallRegions * 2 * PageSize + (Region - SmallRegions) * LargeRegionSize;
+			Page.RegionSize = Region < SmallRegions ? PageSize : LargeRegionSize;
+			Page.Protect = PAGE_READWRITE;
+			EstablishPage(PageSet, Page);
+		}
+
+		auto Start = std::chrono::steady_clock::now();
+		StatusCode = CaptureSnapshots(PageSet, 0, Memory);
+		Seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+		DestroySnapshotArena(PageSet.Arena);
+		if (StatusCode)
+		{
+			printf("FAIL: %s: CaptureSnapshots: %lu\n", Name, static_cast<unsigned long>(StatusCode));
+			return false;
+		}
+	}
+
+	printf("%-16s %zu MiB in %8.2f ms %8.1f MiB/s\n", Name, static_cast<size_t>(TotalBytes / (1024 * 1024)), Seconds * 1000 / Rounds,
+		TotalBytes * Rounds / (1024.0 * 1024.0) / Seconds);
+	CloseProcessMemory(Memory);
+	return true;
+}
+
+int main()
+{
+	crc_initialize(crc_engine_automatic);
+
+	std::vector<BYTE> Storage(SmallRegions * 2 * PageSize + LargeRegions * LargeRegionSize + PageSize);
+	BYTE* Buffer = reinterpret_cast<BYTE*>((reinterpret_cast<uintptr_t>(Storage.data()) + PageSize - 1) & ~(PageSize - 1));
+	for (size_t Offset = 0; Offset < Storage.size() - PageSize; Offset++)
+	{
+		Buffer[Offset] = static_cast<BYTE>(Offset * 2654435761u >> 13);
+	}
+
+	bool Passed = MeasureCapture("in-process", 0, Buffer);
+	Passed &= MeasureCapture("out-of-process", CurrentProcessId(), Buffer);
+	return Passed ? 0 : 1;
+}
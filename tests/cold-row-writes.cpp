@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "page-scanner.h"
+#include <cstdio>
+#include <vector>
+
+//
+// A write to a cold row must not be lost to the dirty bit reset of a full sweep: registers pages of this process as rows, sweeps
+// until a row is not due on the next full sweep, writes to it right before that sweep and checks the sweep reported it
+// (the change is accepted into the row's snapshot). Needs dirty page tracking, the test is skipped without it
+//
+
+static const size_t Rows = 64;
+static const SIZE_T PageSize = 4096;
+static const int MaxSweeps = 100000;
+
+// whether the next slice starts a full sweep
+static bool FullSweepNext(const SWEEP_STATE& State)
+{
+	return State.Cursor == SIZE_MAX && State.Sweep % ScanVerifyInterval == 0;
+}
+
+int main()
+{
+	crc_initialize(crc_engine_automatic);
+	InitializeCompareKernel(CompareKernelAutomatic);
+
+	std::vector<BYTE> Storage(Rows * PageSize + PageSize);
+	BYTE* Buffer = reinterpret_cast<BYTE*>((reinterpret_cast<uintptr_t>(Storage.data()) + PageSize - 1) & ~(PageSize - 1));
+	for (size_t Offset = 0; Offset < Rows * PageSize; Offset++)
+	{
+		Buffer[Offset] = static_cast<BYTE>(Offset * 2654435761u >> 13);
+	}
+
+	PAGE_TABLE<ScanHashPolicy> PageSet = {};
+	PROCESS_MEMORY Memory;
+	if (OpenProcessMemory(Memory, 0) || CreateSnapshotArena(PageSet.Arena, Rows * PageSize, false))
+	{
+		printf("FAIL: could not create the page table\n");
+		return 1;
+	}
+
+	PageSet.Reserve(Rows);
+	for (size_t PageIndex = 0; PageIndex < Rows; PageIndex++)
+	{
+		MEM_REGION Page = {};
+		Page.BaseAddress = Buffer + PageIndex * PageSize;
+		Page.RegionSize = PageSize;
+		Page.Protect = PAGE_READWRITE;
+		EstablishPage(PageSet, Page);
+	}
+	CaptureSnapshots(PageSet, 0, Memory);
+
+	SWEEP_STATE State;
+	OpenSweepState(State, Memory);
+	if (!State.TrackDirty || !ScanAdaptive)
+	{
+		printf("SKIP: needs dirty page tracking and ScanAdaptive\n");
+		CloseSweepState(State);
+		DestroySnapshotArena(PageSet.Arena);
+		CloseProcessMemory(Memory);
+		return 0;
+	}
+
+	//
+	// Sweep until the next sweep is full and some row is not due on it
+	//
+
+	size_t Cold = Rows;
+	for (int Sweep = 0; Sweep < MaxSweeps && Cold == Rows; Sweep++)
+	{
+		SIZE_T Hashed;
+		while (SweepPageSlice(PageSet, Memory, State, SIZE_MAX, Hashed) == SweepPending)
+		{
+		}
+
+		for (size_t PageIndex = 0; FullSweepNext(State) && PageIndex < State.Rows.size(); PageIndex++)
+		{
+			if (State.Rows[PageIndex].NextSweep > State.FullSweeps + 1)
+			{
+				Cold = PageIndex;
+				break;
+			}
+		}
+	}
+
+	bool Passed = Cold < Rows;
+	if (!Passed)
+	{
+		printf("FAIL: no row went cold in %d sweeps\n", MaxSweeps);
+	}
+	else
+	{
+		BYTE* Written = Buffer + Cold * PageSize + 100;
+		*Written ^= 0xFF;
+		BYTE Expected = *Written;
+
+		SIZE_T Hashed;
+		while (SweepPageSlice(PageSet, Memory, State, SIZE_MAX, Hashed) == SweepPending)
+		{
+		}
+
+		Passed = PageSet.Snapshots[Cold][100] == Expected && State.Rows[Cold].Changes;
+		printf("%s: write to cold row %zu %s by the next full sweep\n", Passed ? "PASS" : "FAIL", Cold, Passed ? "reported" : "not reported");
+	}
+
+	CloseSweepState(State);
+	DestroySnapshotArena(PageSet.Arena);
+	CloseProcessMemory(Memory);
+	return Passed ? 0 : 1;
+}
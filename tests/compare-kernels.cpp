@@ -0,0 +1,200 @@
+#include "pch.h"
+#include "page-compare.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+//
+// Forces every FindDifferences kernel and checks its offsets against the scalar kernel on random buffers: every unaligned start
+// and every length up to four blocks, then difference patterns around the 16/32-byte vectors, the 64-byte blocks and the tails
+// shorter than a vector. Then reports the throughput of each on 4 KiB pages
+// Exits non-zero when a kernel disagrees with the scalar kernel
+//
+
+typedef struct _COMPARE_KERNEL_TEST
+{
+	const char* Name;
+	COMPARE_KERNEL Kernel;
+} COMPARE_KERNEL_TEST;
+
+static const COMPARE_KERNEL_TEST Kernels[] =
+{
+	{ "scalar", CompareKernelScalar },
+	{ "sse2", CompareKernelSse2 },
+	{ "avx2", CompareKernelAvx2 },
+};
+
+static unsigned int Seed = 0x12345678;
+
+static unsigned int NextRandom()
+{
+	Seed = Seed * 1103515245 + 12345;
+	return Seed >> 16;
+}
+
+// runs of consecutive offsets, so a disagreement is reported the way ComparePages coalesces it
+static void PrintRuns(const char* Name, const std::vector<size_t>& Offsets)
+{
+	printf("  %-6s", Name);
+	for (size_t Index = 0, Printed = 0; Index < Offsets.size() && Printed < 8; Printed++)
+	{
+		size_t Start = Offsets[Index];
+		while (Index + 1 < Offsets.size() && Offsets[Index + 1] == Offsets[Index] + 1)
+		{
+			Index++;
+		}
+		printf(" [%zu, %zu]", Start, Offsets[Index]);
+		Index++;
+	}
+	printf("\n");
+}
+
+// compares Left and Right (Size bytes) with every kernel against the scalar kernel
+static size_t CheckKernels(const unsigned char* Left, const unsigned char* Right, size_t Size, const char* Case, size_t& Failures)
+{
+	std::vector<size_t> Expected;
+	std::vector<size_t> Offsets;
+
+	InitializeCompareKernel(CompareKernelScalar);
+	FindDifferences(Left, Right, Size, Expected);
+
+	for (const COMPARE_KERNEL_TEST& Test : Kernels)
+	{
+		InitializeCompareKernel(Test.Kernel);
+		if (SelectedCompareKernel() != Test.Kernel)
+		{
+			continue;
+		}
+
+		Offsets.clear();
+		FindDifferences(Left, Right, Size, Offsets);
+		if (Offsets != Expected && Failures++ < 16)
+		{
+			printf("%s disagrees with scalar (%s, size %zu)\n", Test.Name, Case, Size);
+			PrintRuns("scalar", Expected);
+			PrintRuns(Test.Name, Offsets);
+		}
+	}
+	return Expected.size();
+}
+
+static double MeasureMegabytes(COMPARE_KERNEL Kernel, const std::vector<unsigned char>& Left, const std::vector<unsigned char>& Right, size_t Repeats)
+{
+	InitializeCompareKernel(Kernel);
+	std::vector<size_t> Offsets;
+	Offsets.reserve(Left.size());
+
+	auto Start = std::chrono::steady_clock::now();
+	for (size_t Repeat = 0; Repeat < Repeats; Repeat++)
+	{
+		Offsets.clear();
+		FindDifferences(Left.data(), Right.data(), Left.size(), Offsets);
+	}
+	std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - Start;
+	return static_cast<double>(Left.size()) * Repeats / Elapsed.count() / (1024 * 1024);
+}
+
+int main()
+{
+	size_t Failures = 0;
+	for (const COMPARE_KERNEL_TEST& Test : Kernels)
+	{
+		InitializeCompareKernel(Test.Kernel);
+		if (SelectedCompareKernel() != Test.Kernel)
+		{
+			printf("%s is not supported here, skipped\n", Test.Name);
+		}
+	}
+
+	//
+	// Random differences, every start within a block and every length up to four blocks
+	//
+
+	std::vector<unsigned char> Left(4096 + 64);
+	std::vector<unsigned char> Right(Left.size());
+	for (size_t Index = 0; Index < Left.size(); Index++)
+	{
+		Left[Index] = static_cast<unsigned char>(NextRandom());
+		Right[Index] = (NextRandom() % 8) ? Left[Index] : static_cast<unsigned char>(Left[Index] ^ (1 + NextRandom() % 255));
+	}
+
+	for (size_t Offset = 0; Offset < 64; Offset++)
+	{
+		for (size_t Length = 0; Length <= 256; Length++)
+		{
+			CheckKernels(&Left[Offset], &Right[Offset], Length, "random", Failures);
+		}
+	}
+
+	//
+	// Single differences and two-byte runs straddling each vector and block boundary, in a 4 KiB page, in one block and
+	// in buffers whose tails are shorter than a vector
+	//
+
+	const size_t Sizes[] = { 4096, 64, 65, 79, 95, 127, 4050, 4095 };
+	for (size_t Size : Sizes)
+	{
+		std::vector<unsigned char> Same(Left.begin(), Left.begin() + Size);
+		std::vector<unsigned char> Changed(Same);
+		for (size_t Boundary = 0; Boundary <= Size; Boundary += 16)
+		{
+			for (size_t Position = Boundary ? Boundary - 1 : 0; Position <= Boundary && Position < Size; Position++)
+			{
+				Changed[Position] ^= 0x80;
+				CheckKernels(Same.data(), Changed.data(), Size, "boundary", Failures);
+				if (Position + 1 < Size)
+				{
+					Changed[Position + 1] ^= 0x01;
+					CheckKernels(Same.data(), Changed.data(), Size, "boundary run", Failures);
+					Changed[Position + 1] ^= 0x01;
+				}
+				Changed[Position] ^= 0x80;
+			}
+		}
+
+		//
+		// Differences only in the tail after the last full block, and every byte different
+		//
+
+		for (size_t Position = Size & ~static_cast<size_t>(63); Position < Size; Position++)
+		{
+			Changed[Position] ^= 0xFF;
+		}
+		CheckKernels(Same.data(), Changed.data(), Size, "tail", Failures);
+
+		for (size_t Position = 0; Position < Size; Position++)
+		{
+			Changed[Position] = static_cast<unsigned char>(Same[Position] ^ 0xFF);
+		}
+		if (CheckKernels(Same.data(), Changed.data(), Size, "all", Failures) != Size && Failures++ < 16)
+		{
+			printf("scalar missed differences (all, size %zu)\n", Size);
+		}
+	}
+
+	//
+	// Throughput on 4 KiB pages, identical and with a few scattered differences
+	//
+
+	std::vector<unsigned char> Page(Left.begin(), Left.begin() + 4096);
+	std::vector<unsigned char> Sparse(Page);
+	for (size_t Position = 0; Position < Sparse.size(); Position += 509)
+	{
+		Sparse[Position] ^= 0x5A;
+	}
+
+	for (const COMPARE_KERNEL_TEST& Test : Kernels)
+	{
+		InitializeCompareKernel(Test.Kernel);
+		if (SelectedCompareKernel() != Test.Kernel)
+		{
+			continue;
+		}
+		printf("%-6s identical: %8.0f MiB/s | sparse: %8.0f MiB/s\n", Test.Name,
+			MeasureMegabytes(Test.Kernel, Page, Page, 200000), MeasureMegabytes(Test.Kernel, Page, Sparse, 200000));
+	}
+
+	InitializeCompareKernel(CompareKernelAutomatic);
+	printf("selected kernel: %d, %zu failure(s)\n", static_cast<int>(SelectedCompareKernel()), Failures);
+	return Failures ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+#include "pch.h"
+#include "error-checking.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+//
+// Checks every crc_crypt engine against the bytewise reference over unaligned offsets and lengths, and the CRC32C engines
+// against a bitwise Castagnoli reference around the lengths where the three interleaved streams take over,
+// then reports the throughput of each on 4 KiB and 64 MiB buffers
+// Exits non-zero when an engine disagrees with its reference or crc_initialize prefers the wrong polynomial
+//
+
+typedef unsigned int (*CRC_ENGINE_ROUTINE)(crc_buffer pData, crc_size iLen);
+
+typedef struct _CRC_ENGINE_TEST
+{
+	const char* Name;
+	CRC_ENGINE_ROUTINE Routine;
+} CRC_ENGINE_TEST;
+
+static const CRC_ENGINE_TEST Engines[] =
+{
+	{ "bytewise", crc_crypt_bytewise },
+	{ "slice8", crc_crypt_slice8 },
+	{ "slice16", crc_crypt_slice16 },
+	{ "pclmul", crc_crypt_pclmul },
+};
+
+//
+// Lengths the SSE4.2 engine changes path at: three CRC32C_SHORT (256) and three CRC32C_LONG (8192) byte streams,
+// and runs of both block sizes one after the other
+//
+
+static const size_t CastagnoliThresholds[] = { 768, 1536, 24576, 24576 + 768, 49152 + 1536 };
+
+static unsigned int CastagnoliReference(const unsigned char* Data, size_t Length)
+{
+	unsigned int Crc = 0xFFFFFFFF;
+	for (size_t Index = 0; Index < Length; Index++)
+	{
+		Crc ^= Data[Index];
+		for (int Bit = 0; Bit < 8; Bit++)
+		{
+			Crc = (Crc & 1) ? (Crc >> 1) ^ 0x82F63B78 : Crc >> 1;
+		}
+	}
+	return Crc ^ 0xFFFFFFFF;
+}
+
+static void CheckCastagnoli(const unsigned char* Data, size_t Offset, size_t Length, size_t& Failures)
+{
+	unsigned int Expected = CastagnoliReference(Data + Offset, Length);
+	if (crc32c_crypt((crc_buffer)(Data + Offset), static_cast<crc_size>(Length)) != Expected && Failures++ < 16)
+	{
+		printf("crc32c disagrees at offset %zu length %zu\n", Offset, Length);
+	}
+	if (crc_hardware_crc32c && crc32c_crypt_sse42((crc_buffer)(Data + Offset), static_cast<crc_size>(Length)) != Expected && Failures++ < 16)
+	{
+		printf("crc32c sse4.2 disagrees at offset %zu length %zu\n", Offset, Length);
+	}
+}
+
+static double MeasureGigabytes(CRC_ENGINE_ROUTINE Routine, std::vector<unsigned char>& Buffer, size_t Repeats)
+{
+	volatile unsigned int Sink = 0;
+	auto Start = std::chrono::steady_clock::now();
+	for (size_t Repeat = 0; Repeat < Repeats; Repeat++)
+	{
+		Sink = Sink + Routine(Buffer.data(), static_cast<crc_size>(Buffer.size()));
+	}
+	std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - Start;
+	return static_cast<double>(Buffer.size()) * Repeats / Elapsed.count() / 1e9;
+}
+
+int main()
+{
+	//
+	// Only the automatic pick may prefer castagnoli, a named engine keeps ieee
+	//
+
+	size_t Failures = 0;
+	const crc_engine Named[] = { crc_engine_bytewise, crc_engine_slice8, crc_engine_slice16, crc_engine_pclmul };
+	for (crc_engine Engine : Named)
+	{
+		crc_initialize(Engine);
+		if (crc_preferred_polynomial() != crc_polynomial_ieee)
+		{
+			printf("engine %d prefers castagnoli\n", static_cast<int>(Engine));
+			Failures++;
+		}
+	}
+
+	crc_initialize(crc_engine_automatic);
+	bool Castagnoli = crc_selected_engine() != crc_engine_pclmul && crc_hardware_crc32c;
+	if (crc_preferred_polynomial() != (Castagnoli ? crc_polynomial_castagnoli : crc_polynomial_ieee))
+	{
+		printf("the automatic pick prefers the wrong polynomial\n");
+		Failures++;
+	}
+
+	std::vector<unsigned char> Data(49152 + 1536 + 64);
+	unsigned int Seed = 0x12345678;
+	for (unsigned char& Byte : Data)
+	{
+		Seed = Seed * 1103515245 + 12345;
+		Byte = static_cast<unsigned char>(Seed >> 16);
+	}
+
+	//
+	// Equivalence, every offset within a cache line and every length up to 4 KiB
+	//
+
+	for (size_t Offset = 0; Offset < 64; Offset++)
+	{
+		for (size_t Length = 0; Length <= 4096; Length++)
+		{
+			unsigned int Expected = crc_crypt_bytewise(&Data[Offset], static_cast<crc_size>(Length));
+			for (const CRC_ENGINE_TEST& Engine : Engines)
+			{
+				if (Engine.Routine(&Data[Offset], static_cast<crc_size>(Length)) != Expected)
+				{
+					if (Failures++ < 16)
+					{
+						printf("%s disagrees at offset %zu length %zu\n", Engine.Name, Offset, Length);
+					}
+				}
+			}
+		}
+	}
+
+	//
+	// CRC32C, every offset within a word and every length up to 1 KiB, then a few bytes either side of each threshold
+	//
+
+	for (size_t Offset = 0; Offset < 16; Offset++)
+	{
+		for (size_t Length = 0; Length <= 1024; Length++)
+		{
+			CheckCastagnoli(Data.data(), Offset, Length, Failures);
+		}
+
+		for (size_t Threshold : CastagnoliThresholds)
+		{
+			for (size_t Length = Threshold - 9; Length <= Threshold + 9; Length++)
+			{
+				CheckCastagnoli(Data.data(), Offset, Length, Failures);
+			}
+		}
+	}
+
+	if (crc_crypt(&Data[3], 4000) != crc_crypt_bytewise(&Data[3], 4000))
+	{
+		printf("the selected engine disagrees with the reference\n");
+		Failures++;
+	}
+
+	//
+	// Throughput
+	//
+
+	std::vector<unsigned char> Page(4096, 0x5A);
+	std::vector<unsigned char> Large(64 * 1024 * 1024, 0xA5);
+	for (const CRC_ENGINE_TEST& Engine : Engines)
+	{
+		printf("%-8s 4 KiB: %6.2f GB/s | 64 MiB: %6.2f GB/s\n", Engine.Name,
+			MeasureGigabytes(Engine.Routine, Page, 100000), MeasureGigabytes(Engine.Routine, Large, 4));
+	}
+
+	printf("selected engine: %d, %zu failure(s)\n", static_cast<int>(crc_selected_engine()), Failures);
+	return Failures ? 1 : 0;
+}
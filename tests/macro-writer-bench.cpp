@@ -0,0 +1,90 @@
+#include "pch.h"
+#include "macrowriter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//
+// Macro generation throughput: coalesces diff sets of Ranges runs of Length changed bytes each, then times WritePairMacro
+// writing the macro and its undo, reported as bytes of generated code per microsecond (best of Trials)
+// Each macro must hold one WriteProcessMemory per range
+//
+
+static const SIZE_T Gap = 64;
+static const int Trials = 5;
+
+typedef struct _MACRO_CASE
+{
+	size_t Ranges;
+	SIZE_T Length;
+} MACRO_CASE;
+
+static const MACRO_CASE Cases[] = { { 1, 4 }, { 16, 16 }, { 64, 64 }, { 1, 4096 }, { 4, 16384 } };
+
+static size_t CountWrites(const std::string& Macro)
+{
+	size_t Count = 0;
+	for (size_t Found = Macro.find("WriteProcessMemory"); Found != std::string::npos; Found = Macro.find("WriteProcessMemory", Found + 1))
+	{
+		Count++;
+	}
+	return Count;
+}
+
+static bool MeasureMacro(const MACRO_CASE& Case)
+{
+	SIZE_T Size = Case.Ranges * (Case.Length + Gap);
+	std::vector<BYTE> Original(Size);
+	std::vector<BYTE> Current(Size);
+	std::vector<size_t> Offsets;
+	for (SIZE_T Offset = 0; Offset < Size; Offset++)
+	{
+		Original[Offset] = static_cast<BYTE>(Offset * 2654435761u >> 13);
+		Current[Offset] = Original[Offset];
+		if (Offset % (Case.Length + Gap) < Case.Length)
+		{
+			Current[Offset] ^= 0x5A;
+			Offsets.push_back(Offset);
+		}
+	}
+
+	DIFF_SET Diff;
+	CoalesceDifferences(Diff, MODULE_MAIN_EXECUTABLE, 0x1000, Original.data(), Current.data(), Offsets, Gap / 2);
+
+	//
+	// Enough macros per trial for a few milliseconds of work, the writer keeps its buffers between them as the change consumer does
+	//
+
+	MACRO_WRITER Writer;
+	WritePairMacro(Writer, "Bench", Diff);
+	size_t Bytes = Writer.Apply.size() + Writer.Undo.size();
+	size_t Rounds = (std::max)(static_cast<size_t>(1), (16u << 20) / Bytes);
+
+	double Best = 1e30;
+	for (int Trial = 0; Trial < Trials; Trial++)
+	{
+		auto Start = std::chrono::steady_clock::now();
+		for (size_t Round = 0; Round < Rounds; Round++)
+		{
+			WritePairMacro(Writer, "Bench", Diff);
+		}
+		Best = (std::min)(Best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count());
+	}
+
+	bool Passed = Diff.Ranges.size() == Case.Ranges && CountWrites(Writer.Apply) == Case.Ranges && CountWrites(Writer.Undo) == Case.Ranges;
+	printf("%3zu ranges x %5zu B: %8zu bytes of code %8.1f bytes/us%s\n", Case.Ranges, static_cast<size_t>(Case.Length), Bytes,
+		Bytes * Rounds / Best, Passed ? "" : "  FAIL: one WriteProcessMemory per range expected");
+	return Passed;
+}
+
+int main()
+{
+	bool Passed = true;
+	for (const MACRO_CASE& Case : Cases)
+	{
+		Passed &= MeasureMacro(Case);
+	}
+	return Passed ? 0 : 1;
+}
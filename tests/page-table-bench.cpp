@@ -0,0 +1,203 @@
+#include "pch.h"
+#include "page-scanner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+//
+// The page table layout with 100k rows of 4 KiB pages, placed in shuffled order so the hardware prefetcher cannot run from one page into the next
+// Times the walk over the metadata alone and a full sweep, for the page table and for the per-page record it replaced
+// (each row a MEMORY_BASIC_INFORMATION, its snapshot vector and its checksum), the sweep with no prefetch, with the first line
+// of each page prefetched and with PAGE_PREFETCH_LINES lines prefetched, and the chunks of a full sweep through SweepChunk
+// The variants are run interleaved Trials times and the best time of each is reported, so a noisy neighbour skews them alike
+//
+
+static const size_t Rows = 100000;
+static const SIZE_T PageSize = 4096;
+static const int Rounds = 2;
+static const int Trials = 5;
+
+// the record of a page before the page table, as wide as a MEMORY_BASIC_INFORMATION on 64-bit Windows plus its snapshot and checksum
+struct RECORD_ROW
+{
+	PVOID BaseAddress;
+	PVOID AllocationBase;
+	DWORD AllocationProtect;
+	SIZE_T RegionSize;
+	DWORD State;
+	DWORD Protect;
+	DWORD Type;
+	std::vector<BYTE> Page;
+	ScanHashPolicy::Checksum Checksum;
+};
+
+static double Elapsed(std::chrono::steady_clock::time_point Start)
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count() / (static_cast<double>(Rows) * Rounds);
+}
+
+static double WalkRecords(const std::vector<RECORD_ROW>& Records, size_t& Sum)
+{
+	auto Start = std::chrono::steady_clock::now();
+	for (int Round = 0; Round < Rounds; Round++)
+	{
+		for (const RECORD_ROW& Record : Records)
+		{
+			Sum += reinterpret_cast<uintptr_t>(Record.BaseAddress) + Record.RegionSize + *reinterpret_cast<const BYTE*>(&Record.Checksum);
+		}
+	}
+	return Elapsed(Start);
+}
+
+static double WalkTable(const PAGE_TABLE<ScanHashPolicy>& PageSet, size_t& Sum)
+{
+	auto Start = std::chrono::steady_clock::now();
+	for (int Round = 0; Round < Rounds; Round++)
+	{
+		for (size_t PageIndex = 0; PageIndex < PageSet.Count(); PageIndex++)
+		{
+			Sum += reinterpret_cast<uintptr_t>(PageSet.Bases[PageIndex]) + PageSet.Sizes[PageIndex] + *reinterpret_cast<const BYTE*>(&PageSet.Checksums[PageIndex]);
+		}
+	}
+	return Elapsed(Start);
+}
+
+static double SweepRecords(const std::vector<RECORD_ROW>& Records, size_t& Mismatches)
+{
+	auto Start = std::chrono::steady_clock::now();
+	for (int Round = 0; Round < Rounds; Round++)
+	{
+		for (const RECORD_ROW& Record : Records)
+		{
+			Mismatches += ScanHashPolicy::Recompute(Record.BaseAddress, Record.RegionSize, Record.Checksum) != Record.Checksum;
+		}
+	}
+	return Elapsed(Start);
+}
+
+// the sweep loop of SweepChunk with the first Lines cache lines of the page PAGE_PREFETCH_DISTANCE rows ahead prefetched
+template <size_t Lines>
+static double SweepTable(const PAGE_TABLE<ScanHashPolicy>& PageSet, const LIVE_WINDOW& Window, size_t& Mismatches)
+{
+	auto Start = std::chrono::steady_clock::now();
+	for (int Round = 0; Round < Rounds; Round++)
+	{
+		for (size_t PageIndex = 0; PageIndex < PageSet.Count(); PageIndex++)
+		{
+			size_t Ahead = PageIndex + PAGE_PREFETCH_DISTANCE;
+			if (Ahead < Window.Live.size())
+			{
+				for (size_t Line = 0; Line < Lines; Line++)
+				{
+					PAGE_TABLE_PREFETCH(reinterpret_cast<const char*>(Window.Live[Ahead]) + Line * PAGE_PREFETCH_LINE_SIZE);
+				}
+			}
+
+			ScanHashPolicy::Checksum Checksum;
+			Mismatches += EvaluatePage(ViewPage(PageSet, PageIndex, Window.Live[PageIndex]), Checksum);
+		}
+	}
+	return Elapsed(Start);
+}
+
+// the chunks of a full sweep through SweepChunk itself, on the calling thread
+static double SweepChunks(const PAGE_TABLE<ScanHashPolicy>& PageSet, SWEEP_STATE& State)
+{
+	auto Start = std::chrono::steady_clock::now();
+	for (int Round = 0; Round < Rounds; Round++)
+	{
+		State.Mismatches.Reset(State.Chunks.size() + PageSet.Count());
+		for (const SWEEP_CHUNK& Chunk : State.Chunks)
+		{
+			SweepChunk(PageSet, State, 0, Chunk);
+		}
+	}
+	return Elapsed(Start);
+}
+
+int main()
+{
+	crc_initialize(crc_engine_automatic);
+
+	std::vector<BYTE> Storage(Rows * PageSize + PageSize);
+	BYTE* Buffer = reinterpret_cast<BYTE*>((reinterpret_cast<uintptr_t>(Storage.data()) + PageSize - 1) & ~(PageSize - 1));
+	for (size_t Offset = 0; Offset < Rows * PageSize; Offset++)
+	{
+		Buffer[Offset] = static_cast<BYTE>(Offset * 2654435761u >> 13);
+	}
+
+	std::vector<size_t> Order(Rows);
+	std::iota(Order.begin(), Order.end(), 0);
+	std::shuffle(Order.begin(), Order.end(), std::mt19937(7));
+
+	PAGE_TABLE<ScanHashPolicy> PageSet = {};
+	PROCESS_MEMORY Memory;
+	if (OpenProcessMemory(Memory, 0) || CreateSnapshotArena(PageSet.Arena, Rows * PageSize, false))
+	{
+		printf("FAIL: could not create the page table\n");
+		return 1;
+	}
+
+	PageSet.Reserve(Rows);
+	for (size_t PageIndex = 0; PageIndex < Rows; PageIndex++)
+	{
+		MEM_REGION Page = {};
+		Page.BaseAddress = Buffer + Order[PageIndex] * PageSize;
+		Page.RegionSize = PageSize;
+		Page.Protect = PAGE_READWRITE;
+		EstablishPage(PageSet, Page);
+	}
+	CaptureSnapshots(PageSet, 0, Memory);
+
+	std::vector<RECORD_ROW> Records(Rows);
+	for (size_t PageIndex = 0; PageIndex < Rows; PageIndex++)
+	{
+		Records[PageIndex].BaseAddress = PageSet.Bases[PageIndex];
+		Records[PageIndex].RegionSize = PageSize;
+		Records[PageIndex].Page.assign(PageSet.Snapshots[PageIndex], PageSet.Snapshots[PageIndex] + PageSize);
+		Records[PageIndex].Checksum = PageSet.Checksums[PageIndex];
+	}
+
+	SWEEP_STATE State;
+	OpenSweepState(State, Memory);
+	ReadLiveWindow(Memory, PageSet, 0, Rows * PageSize, State.Window);
+	BuildSweepChunks(PageSet, State, 0, Rows);
+	const LIVE_WINDOW& Window = State.Window;
+
+	size_t Sum = 0;
+	size_t Mismatches = 0;
+	double Best[7] = { 1e30, 1e30, 1e30, 1e30, 1e30, 1e30, 1e30 };
+	for (int Trial = 0; Trial < Trials; Trial++)
+	{
+		Best[0] = (std::min)(Best[0], WalkRecords(Records, Sum));
+		Best[1] = (std::min)(Best[1], WalkTable(PageSet, Sum));
+		Best[2] = (std::min)(Best[2], SweepRecords(Records, Mismatches));
+		Best[3] = (std::min)(Best[3], SweepTable<0>(PageSet, Window, Mismatches));
+		Best[4] = (std::min)(Best[4], SweepTable<1>(PageSet, Window, Mismatches));
+		Best[5] = (std::min)(Best[5], SweepTable<PAGE_PREFETCH_LINES>(PageSet, Window, Mismatches));
+		Best[6] = (std::min)(Best[6], SweepChunks(PageSet, State));
+		Mismatches += State.Mismatches.Size();
+	}
+
+	size_t RowBytes = sizeof(PVOID) + sizeof(SIZE_T) + sizeof(ScanHashPolicy::Checksum);
+	printf("metadata walk, per-page record (%zu bytes/row) %6.2f ns/row\n", sizeof(RECORD_ROW), Best[0]);
+	printf("metadata walk, page table      (%zu bytes/row) %6.2f ns/row\n", RowBytes, Best[1]);
+	printf("sweep, per-page record                         %6.1f ns/row\n", Best[2]);
+	printf("sweep, page table, no prefetch                 %6.1f ns/row\n", Best[3]);
+	printf("sweep, page table, first line prefetched       %6.1f ns/row\n", Best[4]);
+	printf("sweep, page table, %d lines prefetched          %6.1f ns/row\n", PAGE_PREFETCH_LINES, Best[5]);
+	printf("sweep, SweepChunk                              %6.1f ns/row\n", Best[6]);
+
+	CloseSweepState(State);
+	DestroySnapshotArena(PageSet.Arena);
+	CloseProcessMemory(Memory);
+	if (Mismatches)
+	{
+		printf("FAIL: %zu mismatches (checksum %zu)\n", Mismatches, Sum);
+		return 1;
+	}
+	return 0;
+}
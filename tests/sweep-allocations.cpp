@@ -0,0 +1,109 @@
+#include "pch.h"
+#include "page-scanner.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+//
+// A steady-state sweep must not allocate: scans this process's own executable, then counts the calls to the global
+// operator new made by SweepPageSlice over many sweeps, both whole sweeps on the worker pool and budgeted slices
+//
+
+static std::atomic<size_t> Allocations{ 0 };
+
+void* operator new(size_t Size)
+{
+	Allocations.fetch_add(1, std::memory_order_relaxed);
+	void* Block = malloc(Size ? Size : 1);
+	if (!Block)
+	{
+		throw std::bad_alloc();
+	}
+	return Block;
+}
+
+void* operator new[](size_t Size)
+{
+	return operator new(Size);
+}
+
+void operator delete(void* Block) noexcept
+{
+	free(Block);
+}
+
+void operator delete[](void* Block) noexcept
+{
+	free(Block);
+}
+
+void operator delete(void* Block, size_t) noexcept
+{
+	free(Block);
+}
+
+void operator delete[](void* Block, size_t) noexcept
+{
+	free(Block);
+}
+
+static const int WarmupSweeps = 4;
+static const int MeasuredSweeps = 64;
+static const SIZE_T SliceBudget = 64 * 1024;
+
+// runs Sweeps full sweeps, each as slices of at most Budget bytes, returning the allocations they made
+static size_t CountSweepAllocations(PAGE_TABLE<ScanHashPolicy>& PageSet, PROCESS_MEMORY& Memory, SWEEP_STATE& State, SIZE_T Budget, int Sweeps)
+{
+	size_t Before = Allocations.load(std::memory_order_relaxed);
+	for (int Sweep = 0; Sweep < Sweeps; Sweep++)
+	{
+		SIZE_T Hashed;
+		while (SweepPageSlice(PageSet, Memory, State, Budget, Hashed) == SweepPending)
+		{
+		}
+	}
+	return Allocations.load(std::memory_order_relaxed) - Before;
+}
+
+int main()
+{
+	crc_initialize(crc_engine_automatic);
+	InitializeCompareKernel(CompareKernelAutomatic);
+
+	PROCESS_MEMORY Memory;
+	PAGE_TABLE<ScanHashPolicy> PageSet = {};
+	wchar_t ModuleName[] = L"";
+	if (OpenProcessMemory(Memory, 0) || GetModulePages(Memory, ModuleName, PageSet) || !PageSet.Count())
+	{
+		printf("FAIL: could not capture the pages of this process\n");
+		return 1;
+	}
+
+	WORKER_POOL Pool;
+	StartWorkerPool(Pool, 2);
+	SWEEP_STATE State;
+	OpenSweepState(State, Memory, &Pool);
+
+	//
+	// The first sweeps size the reused buffers of the sweep state and report whatever changed since the capture
+	//
+
+	CountSweepAllocations(PageSet, Memory, State, SIZE_MAX, WarmupSweeps);
+	CountSweepAllocations(PageSet, Memory, State, SliceBudget, WarmupSweeps);
+
+	size_t Whole = CountSweepAllocations(PageSet, Memory, State, SIZE_MAX, MeasuredSweeps);
+	size_t Sliced = CountSweepAllocations(PageSet, Memory, State, SliceBudget, MeasuredSweeps);
+
+	CloseSweepState(State);
+	StopWorkerPool(Pool);
+
+	printf("%zu pages, %d sweeps: %zu allocations whole, %zu allocations in %zu byte slices\n", PageSet.Count(), MeasuredSweeps,
+		Whole, Sliced, static_cast<size_t>(SliceBudget));
+	if (Whole || Sliced)
+	{
+		printf("FAIL: steady-state sweeps allocated\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,291 @@
+#include "pch.h"
+#include "worker-pool.h"
+#include "platform.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+void ParallelFor(size_t Count, const std::function<void(size_t)>& Routine, size_t ThreadCount)
+{
+	if (ThreadCount == 0)
+	{
+		ThreadCount = std::thread::hardware_concurrency();
+	}
+
+	if (ThreadCount > Count)
+	{
+		ThreadCount = Count;
+	}
+
+	std::atomic<size_t> NextIndex(0);
+	auto Worker = [&]()
+	{
+		for (size_t Index = NextIndex.fetch_add(1); Index < Count; Index = NextIndex.fetch_add(1))
+		{
+			Routine(Index);
+		}
+	};
+
+	//
+	// The calling thread is one of the workers, so only ThreadCount - 1 threads are created
+	//
+
+	std::vector<std::thread> Workers;
+	for (size_t ThreadIndex = 1; ThreadIndex < ThreadCount; ThreadIndex++)
+	{
+		Workers.emplace_back(Worker);
+	}
+
+	Worker();
+
+	for (std::thread& WorkerThread : Workers)
+	{
+		WorkerThread.join();
+	}
+}
+
+static unsigned long long PackRange(size_t Begin, size_t End)
+{
+	return static_cast<unsigned long long>(Begin) | (static_cast<unsigned long long>(End) << 32);
+}
+
+//
+// Takes the item at the front of the worker's own range
+//
+
+static bool TakeItem(WORKER_RANGE& Own, size_t& Index)
+{
+	unsigned long long Range = Own.Range.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		size_t Begin = static_cast<size_t>(Range & 0xFFFFFFFF);
+		size_t End = static_cast<size_t>(Range >> 32);
+		if (Begin >= End)
+		{
+			return false;
+		}
+
+		if (Own.Range.compare_exchange_weak(Range, PackRange(Begin + 1, End), std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			Index = Begin;
+			return true;
+		}
+	}
+}
+
+//
+// Moves the back half of a victim's range (at least one item) into the thief's own, empty, range
+//
+
+static bool StealItems(WORKER_RANGE& Victim, WORKER_RANGE& Own)
+{
+	unsigned long long Range = Victim.Range.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		size_t Begin = static_cast<size_t>(Range & 0xFFFFFFFF);
+		size_t End = static_cast<size_t>(Range >> 32);
+		if (Begin >= End)
+		{
+			return false;
+		}
+
+		size_t Half = (End - Begin + 1) / 2;
+		if (Victim.Range.compare_exchange_weak(Range, PackRange(Begin, End - Half), std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			Own.Range.store(PackRange(End - Half, End), std::memory_order_release);
+			return true;
+		}
+	}
+}
+
+/*++
+
+Routine Description:
+
+	Runs the items of the current run as worker Worker, first from its own range, then stolen from the others
+	Returns once every range was seen empty, no item is added during a run so nothing is left then but items already taken
+
+--*/
+static void RunWorkerItems(WORKER_POOL& Pool, size_t Worker)
+{
+	WORKER_ROUTINE Routine = Pool.Routine;
+	void* Context = Pool.Context;
+	WORKER_RANGE& Own = Pool.Ranges[Worker];
+
+	for (;;)
+	{
+		size_t Index;
+		while (TakeItem(Own, Index))
+		{
+			Routine(Context, Index);
+		}
+
+		bool Stolen = false;
+		for (size_t Offset = 1; Offset < Pool.ThreadCount && !Stolen; Offset++)
+		{
+			Stolen = StealItems(Pool.Ranges[(Worker + Offset) % Pool.ThreadCount], Own);
+		}
+
+		if (!Stolen)
+		{
+			return;
+		}
+	}
+}
+
+static void PinThread(std::thread& Thread, size_t Processor)
+{
+#if defined(_WIN32)
+	if (Processor < sizeof(DWORD_PTR) * 8)
+	{
+		SetThreadAffinityMask(reinterpret_cast<HANDLE>(Thread.native_handle()), static_cast<DWORD_PTR>(1) << Processor);
+	}
+#else
+	cpu_set_t Set;
+	CPU_ZERO(&Set);
+	CPU_SET(Processor, &Set);
+	pthread_setaffinity_np(Thread.native_handle(), sizeof(Set), &Set);
+#endif
+}
+
+/*++
+
+Routine Description:
+
+	Starts the worker threads of the pool, the thread calling RunWorkerPool is a worker too, so ThreadCount - 1 threads are created
+
+Parameters:
+
+	Pool - The worker pool
+	ThreadCount - The number of workers, 0 for one per hardware thread
+	PinThreads - Pins worker N to logical processor N, keeping each worker's caches warm; the calling thread is left as it is
+
+Return Value:
+
+	None
+
+--*/
+void StartWorkerPool(WORKER_POOL& Pool, size_t ThreadCount, bool PinThreads)
+{
+	if (ThreadCount == 0)
+	{
+		ThreadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	}
+
+	Pool.ThreadCount = ThreadCount;
+	Pool.Ranges.reset(new WORKER_RANGE[ThreadCount]);
+	Pool.Generation = 0;
+	Pool.Active = 0;
+	Pool.Stopping = false;
+
+	for (size_t Worker = 1; Worker < ThreadCount; Worker++)
+	{
+		Pool.Ranges[Worker].Range.store(0);
+		Pool.Threads.emplace_back([&Pool, Worker]()
+		{
+			size_t Generation = 0;
+			for (;;)
+			{
+				{
+					std::unique_lock<std::mutex> Guard(Pool.Lock);
+					Pool.Start.wait(Guard, [&]() { return Pool.Stopping || Pool.Generation != Generation; });
+					if (Pool.Stopping)
+					{
+						return;
+					}
+					Generation = Pool.Generation;
+				}
+
+				RunWorkerItems(Pool, Worker);
+
+				std::lock_guard<std::mutex> Guard(Pool.Lock);
+				if (--Pool.Active == 0)
+				{
+					Pool.Done.notify_one();
+				}
+			}
+		});
+
+		if (PinThreads)
+		{
+			PinThread(Pool.Threads.back(), Worker % (std::max)(1u, std::thread::hardware_concurrency()));
+		}
+	}
+	Pool.Ranges[0].Range.store(0);
+}
+
+/*++
+
+Routine Description:
+
+	Runs Routine(Context, Index) for every Index in [0, Count) across the workers of the pool, the calling thread included
+	Returns once every item has completed, results pushed to a RESULT_QUEUE by the items are then visible to the caller
+	Only one thread may run the pool at a time
+
+Parameters:
+
+	Pool - The worker pool, started by StartWorkerPool
+	Count - The number of work items, less than 2^32
+	Routine - The routine invoked as Routine(Context, Index) for each work item, must be safe to call concurrently for different indices
+	Context - Passed to Routine
+
+Return Value:
+
+	size_t - The number of threads the run occupied, 1 when the items ran on the calling thread alone
+
+--*/
+size_t RunWorkerPool(WORKER_POOL& Pool, size_t Count, WORKER_ROUTINE Routine, void* Context)
+{
+	if (Pool.ThreadCount <= 1 || Count <= 1)
+	{
+		for (size_t Index = 0; Index < Count; Index++)
+		{
+			Routine(Context, Index);
+		}
+		return 1;
+	}
+
+	for (size_t Worker = 0; Worker < Pool.ThreadCount; Worker++)
+	{
+		Pool.Ranges[Worker].Range.store(PackRange(Count * Worker / Pool.ThreadCount, Count * (Worker + 1) / Pool.ThreadCount), std::memory_order_relaxed);
+	}
+
+	{
+		std::lock_guard<std::mutex> Guard(Pool.Lock);
+		Pool.Routine = Routine;
+		Pool.Context = Context;
+		Pool.Active = Pool.ThreadCount - 1;
+		Pool.Generation++;
+	}
+	Pool.Start.notify_all();
+
+	RunWorkerItems(Pool, 0);
+
+	std::unique_lock<std::mutex> Guard(Pool.Lock);
+	Pool.Done.wait(Guard, [&]() { return Pool.Active == 0; });
+	Pool.Routine = NULL;
+	Pool.Context = NULL;
+	return Pool.ThreadCount;
+}
+
+void StopWorkerPool(WORKER_POOL& Pool)
+{
+	{
+		std::lock_guard<std::mutex> Guard(Pool.Lock);
+		Pool.Stopping = true;
+	}
+	Pool.Start.notify_all();
+
+	for (std::thread& Thread : Pool.Threads)
+	{
+		Thread.join();
+	}
+	Pool.Threads.clear();
+	Pool.ThreadCount = 1;
+}
+
@@ -0,0 +1,122 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*++
+
+Routine Description:
+
+	Runs Routine(Index) for every Index in [0, Count) across a pool of worker threads, the calling thread included
+	Indices are handed out one at a time from a shared counter, so uneven work items balance themselves
+	Returns once every item has completed
+
+Parameters:
+
+	Count - The number of work items
+	Routine - The routine invoked for each work item, must be safe to call concurrently for different indices
+	ThreadCount - The number of threads to run on, 0 for one per hardware thread
+
+Return Value:
+
+	None
+
+--*/
+void ParallelFor(size_t Count, const std::function<void(size_t)>& Routine, size_t ThreadCount = 0);
+
+//
+// Worker Pool
+// Persistent worker threads for the work repeated every sweep, so no thread is created per sweep
+// Each run deals the items out as one contiguous range per worker; a worker takes items from the front of its own range
+// and, once it is empty, steals the back half of another worker's range. A range is a single atomic word (Begin | End << 32)
+// updated by compare-and-swap, so neither taking nor stealing locks
+// The routine of a run is a plain function with a context pointer, so starting a run does not allocate
+//
+
+typedef void (*WORKER_ROUTINE)(void* Context, size_t Index);
+
+typedef struct _WORKER_RANGE
+{
+	alignas(64) std::atomic<unsigned long long> Range;
+} WORKER_RANGE;
+
+typedef struct _WORKER_POOL
+{
+	std::vector<std::thread> Threads;
+	std::unique_ptr<WORKER_RANGE[]> Ranges;
+	size_t ThreadCount = 1;
+	std::mutex Lock;
+	std::condition_variable Start;
+	std::condition_variable Done;
+	size_t Generation = 0;
+	size_t Active = 0;
+	bool Stopping = false;
+	WORKER_ROUTINE Routine = NULL;
+	void* Context = NULL;
+} WORKER_POOL;
+
+void StartWorkerPool(WORKER_POOL& Pool, size_t ThreadCount = 0, bool PinThreads = false);
+size_t RunWorkerPool(WORKER_POOL& Pool, size_t Count, WORKER_ROUTINE Routine, void* Context);
+void StopWorkerPool(WORKER_POOL& Pool);
+
+//
+// Result Queue
+// Collects the results of a run of the worker pool without locking: a push claims a slot with one atomic increment
+// Sized before the run for the most results it can receive, read once the run returned
+//
+
+template <class T>
+struct RESULT_QUEUE
+{
+	std::vector<T> Items;
+	std::atomic<size_t> Count{ 0 };
+
+	void Reset(size_t Capacity)
+	{
+		if (Items.size() < Capacity)
+		{
+			Items.resize(Capacity);
+		}
+		Count.store(0, std::memory_order_relaxed);
+	}
+
+	void Push(const T& Item)
+	{
+		Items[Count.fetch_add(1, std::memory_order_relaxed)] = Item;
+	}
+
+	size_t Size() const
+	{
+		return Count.load(std::memory_order_relaxed);
+	}
+};
+
@@ -0,0 +1,775 @@
+#include "pch.h"
+#include "write-monitor.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <atomic>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/userfaultfd.h>
+#endif
+
+//
+// Fault messages read from the userfaultfd per read()
+//
+
+#define WRITE_MONITOR_MESSAGES 64
+
+//
+// Capacity of the trap engine's fault ring, a power of two
+// When the handler thread falls this far behind, every monitored page is handed out (and re-armed) instead
+//
+
+#define WRITE_TRAP_RING_SIZE 4096
+
+#if defined(__linux__)
+
+static DWORD WriteProtectRange(int FaultDescriptor, PVOID Base, SIZE_T Size, bool Protect)
+{
+	uffdio_writeprotect WriteProtect = {};
+	WriteProtect.range.start = reinterpret_cast<unsigned long long>(Base);
+	WriteProtect.range.len = Size;
+	WriteProtect.mode = Protect ? UFFDIO_WRITEPROTECT_MODE_WP : 0;
+
+	if (ioctl(FaultDescriptor, UFFDIO_WRITEPROTECT, &WriteProtect) < 0)
+	{
+		return errno;
+	}
+	return 0;
+}
+
+/*++
+
+Routine Description:
+
+	The userfaultfd handler thread, blocks until a write fault (or the stop event) arrives
+	Each write protect fault is recorded with its page and time, then the page is unprotected, which wakes the writer
+
+Parameters:
+
+	Monitor - The started write monitor
+
+Return Value:
+
+	None
+
+--*/
+static void UserfaultfdHandler(WRITE_MONITOR* Monitor)
+{
+	pollfd Descriptors[2] = { { Monitor->FaultDescriptor, POLLIN, 0 }, { Monitor->StopDescriptor, POLLIN, 0 } };
+	uffd_msg Messages[WRITE_MONITOR_MESSAGES];
+
+	for (;;)
+	{
+		if (poll(Descriptors, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+
+		if (Descriptors[1].revents)
+		{
+			break;
+		}
+
+		ssize_t Read = read(Monitor->FaultDescriptor, Messages, sizeof(Messages));
+		if (Read < 0)
+		{
+			if (errno == EAGAIN || errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+
+		size_t Count = Read / sizeof(Messages[0]);
+		std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+
+		{
+			std::lock_guard<std::mutex> Guard(Monitor->Lock);
+			for (size_t Index = 0; Index < Count; Index++)
+			{
+				if (Messages[Index].event == UFFD_EVENT_PAGEFAULT && (Messages[Index].arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WP))
+				{
+					size_t Page = Messages[Index].arg.pagefault.address & ~static_cast<unsigned long long>(Monitor->PageSize - 1);
+					Monitor->Pending.push_back({ reinterpret_cast<PVOID>(Page), Now });
+				}
+			}
+		}
+
+		for (size_t Index = 0; Index < Count; Index++)
+		{
+			if (Messages[Index].event == UFFD_EVENT_PAGEFAULT && (Messages[Index].arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WP))
+			{
+				size_t Page = Messages[Index].arg.pagefault.address & ~static_cast<unsigned long long>(Monitor->PageSize - 1);
+				WriteProtectRange(Monitor->FaultDescriptor, reinterpret_cast<PVOID>(Page), Monitor->PageSize, false);
+			}
+		}
+
+		Monitor->Signal.notify_one();
+	}
+}
+
+/*++
+
+Routine Description:
+
+	Opens a userfaultfd, registers every region in write protect mode and write protects it
+	UFFD_USER_MODE_ONLY is tried first, it is permitted to unprivileged processes when vm.unprivileged_userfaultfd is 0
+
+Return Value:
+
+	DWORD - 0, ERROR_NOT_SUPPORTED or errno
+
+--*/
+static DWORD StartUserfaultfd(WRITE_MONITOR& Monitor, const std::vector<PVOID>& Bases, const std::vector<SIZE_T>& Sizes)
+{
+#if defined(UFFD_USER_MODE_ONLY)
+	int FaultDescriptor = static_cast<int>(syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY));
+	if (FaultDescriptor < 0)
+	{
+		FaultDescriptor = static_cast<int>(syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK));
+	}
+#else
+	int FaultDescriptor = static_cast<int>(syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK));
+#endif
+	if (FaultDescriptor < 0)
+	{
+		return errno;
+	}
+
+	uffdio_api Api = {};
+	Api.api = UFFD_API;
+	if (ioctl(FaultDescriptor, UFFDIO_API, &Api) < 0 || !(Api.features & UFFD_FEATURE_PAGEFAULT_FLAG_WP))
+	{
+		close(FaultDescriptor);
+		return ERROR_NOT_SUPPORTED;
+	}
+
+	//
+	// Closing the descriptor unregisters every range and wakes any blocked writer, so it is the cleanup on failure
+	//
+
+	for (size_t Index = 0; Index < Bases.size(); Index++)
+	{
+		uffdio_register Register = {};
+		Register.range.start = reinterpret_cast<unsigned long long>(Bases[Index]);
+		Register.range.len = Sizes[Index];
+		Register.mode = UFFDIO_REGISTER_MODE_WP;
+
+		DWORD StatusCode = 0;
+		if (ioctl(FaultDescriptor, UFFDIO_REGISTER, &Register) < 0)
+		{
+			StatusCode = errno;
+		}
+		else if (!(Register.ioctls & (1ULL << _UFFDIO_WRITEPROTECT)))
+		{
+			StatusCode = ERROR_NOT_SUPPORTED;
+		}
+		else
+		{
+			StatusCode = WriteProtectRange(FaultDescriptor, Bases[Index], Sizes[Index], true);
+		}
+
+		if (StatusCode)
+		{
+			close(FaultDescriptor);
+			return StatusCode;
+		}
+	}
+
+	Monitor.StopDescriptor = eventfd(0, EFD_CLOEXEC);
+	if (Monitor.StopDescriptor < 0)
+	{
+		DWORD StatusCode = errno;
+		close(FaultDescriptor);
+		return StatusCode;
+	}
+
+	Monitor.FaultDescriptor = FaultDescriptor;
+	Monitor.Handler = std::thread(UserfaultfdHandler, &Monitor);
+	return 0;
+}
+//
+// Trap engine state, a signal handler has no context so there is one trap monitor per process
+// The ring is a bounded lock-free queue (per-slot sequence numbers) filled by the SIGSEGV handler of any thread
+// and drained by the handler thread, it is preallocated and never locks so the signal handler stays async-signal-safe
+//
+
+typedef struct _WRITE_TRAP_SLOT
+{
+	std::atomic<size_t> Sequence;
+	size_t Page;
+	long long Time;
+} WRITE_TRAP_SLOT;
+
+static_assert(std::atomic<size_t>::is_always_lock_free, "the trap ring must be lock-free to be used from a signal handler");
+
+static WRITE_TRAP_SLOT TrapRing[WRITE_TRAP_RING_SIZE];
+static std::atomic<size_t> TrapRingTail;
+static size_t TrapRingHead;
+static std::atomic<bool> TrapRingOverflow;
+static std::atomic<WRITE_MONITOR*> TrapMonitor;
+static struct sigaction TrapPreviousAction;
+static bool TrapInstalled;
+
+static int TrapProtection(DWORD Protect)
+{
+	switch (Protect)
+	{
+	case PAGE_READONLY:
+		return PROT_READ;
+	case PAGE_READWRITE:
+	case PAGE_WRITECOPY:
+		return PROT_READ | PROT_WRITE;
+	case PAGE_EXECUTE:
+		return PROT_EXEC;
+	case PAGE_EXECUTE_READ:
+		return PROT_READ | PROT_EXEC;
+	case PAGE_EXECUTE_READWRITE:
+		return PROT_READ | PROT_WRITE | PROT_EXEC;
+	}
+	return PROT_NONE;
+}
+
+static bool TrapRingPush(size_t Page, long long Time)
+{
+	size_t Position = TrapRingTail.load(std::memory_order_relaxed);
+	WRITE_TRAP_SLOT* Slot;
+	for (;;)
+	{
+		Slot = &TrapRing[Position & (WRITE_TRAP_RING_SIZE - 1)];
+		size_t Sequence = Slot->Sequence.load(std::memory_order_acquire);
+		if (Sequence == Position)
+		{
+			if (TrapRingTail.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (Sequence < Position)
+		{
+			return false;
+		}
+		else
+		{
+			Position = TrapRingTail.load(std::memory_order_relaxed);
+		}
+	}
+
+	Slot->Page = Page;
+	Slot->Time = Time;
+	Slot->Sequence.store(Position + 1, std::memory_order_release);
+	return true;
+}
+
+static bool TrapRingPop(size_t& Page, long long& Time)
+{
+	WRITE_TRAP_SLOT* Slot = &TrapRing[TrapRingHead & (WRITE_TRAP_RING_SIZE - 1)];
+	if (Slot->Sequence.load(std::memory_order_acquire) != TrapRingHead + 1)
+	{
+		return false;
+	}
+
+	Page = Slot->Page;
+	Time = Slot->Time;
+	Slot->Sequence.store(TrapRingHead + WRITE_TRAP_RING_SIZE, std::memory_order_release);
+	TrapRingHead++;
+	return true;
+}
+
+/*++
+
+Routine Description:
+
+	Finds the monitored region containing an address, async-signal-safe (the region arrays do not change while started)
+
+Return Value:
+
+	size_t - The index of the region, or Bases.size() when no region contains it
+
+--*/
+static size_t FindMonitorRegion(const WRITE_MONITOR* Monitor, size_t Address)
+{
+	size_t Low = 0;
+	size_t High = Monitor->Bases.size();
+	while (Low < High)
+	{
+		size_t Middle = Low + (High - Low) / 2;
+		if (reinterpret_cast<size_t>(Monitor->Bases[Middle]) <= Address)
+		{
+			Low = Middle + 1;
+		}
+		else
+		{
+			High = Middle;
+		}
+	}
+
+	if (Low == 0 || Address >= reinterpret_cast<size_t>(Monitor->Bases[Low - 1]) + Monitor->Sizes[Low - 1])
+	{
+		return Monitor->Bases.size();
+	}
+	return Low - 1;
+}
+
+/*++
+
+Routine Description:
+
+	The SIGSEGV handler of the trap engine. A write to an armed page is recorded in the ring (or the overflow flag),
+	write access is restored to the page and the handler thread is woken, then the write is retried on return
+	Faults outside the monitored pages are passed on to the previous handler. Without one (SIG_DFL or SIG_IGN) such a fault
+	terminates the process through the previous action
+	Only async-signal-safe calls: atomics, clock_gettime, mprotect, write, sigaction and raise
+
+--*/
+static void TrapHandler(int Signal, siginfo_t* Information, void* Context)
+{
+	int SavedError = errno;
+	WRITE_MONITOR* Monitor = TrapMonitor.load(std::memory_order_acquire);
+
+	if (Monitor && Information->si_code == SEGV_ACCERR)
+	{
+		size_t Address = reinterpret_cast<size_t>(Information->si_addr);
+		size_t Region = FindMonitorRegion(Monitor, Address);
+		if (Region < Monitor->Bases.size())
+		{
+			size_t Page = Address & ~(Monitor->PageSize - 1);
+
+			timespec Now;
+			clock_gettime(CLOCK_MONOTONIC, &Now);
+			if (!TrapRingPush(Page, Now.tv_sec * 1000000000LL + Now.tv_nsec))
+			{
+				TrapRingOverflow.store(true, std::memory_order_release);
+			}
+
+			mprotect(reinterpret_cast<void*>(Page), Monitor->PageSize, TrapProtection(Monitor->Protections[Region]));
+
+			unsigned long long Wake = 1;
+			ssize_t Written = write(Monitor->FaultDescriptor, &Wake, sizeof(Wake));
+			(void)Written;
+
+			errno = SavedError;
+			return;
+		}
+	}
+
+	errno = SavedError;
+	if (TrapPreviousAction.sa_flags & SA_SIGINFO)
+	{
+		TrapPreviousAction.sa_sigaction(Signal, Information, Context);
+	}
+	else if (TrapPreviousAction.sa_handler != SIG_DFL && TrapPreviousAction.sa_handler != SIG_IGN)
+	{
+		TrapPreviousAction.sa_handler(Signal);
+	}
+	else if (TrapPreviousAction.sa_handler == SIG_IGN && Information->si_code <= 0)
+	{
+		//
+		// Sent with kill or sigqueue rather than raised by a fault, ignored as it was before the trap, which stays installed
+		//
+	}
+	else
+	{
+		//
+		// A fault outside the monitored pages with no handler to pass it to is fatal to the process, as it would be without the trap:
+		// the previous action is restored and the signal raised again, delivered once the handler returns. This removes the trap
+		// for every thread, but only on the way to terminating the process (the kernel forces the default action on an ignored fault)
+		//
+
+		sigaction(Signal, &TrapPreviousAction, NULL);
+		raise(Signal);
+	}
+}
+
+/*++
+
+Routine Description:
+
+	The handler thread of the trap engine, drains the ring into the pending faults every time the signal handler wakes it
+	After an overflow every page of every region is handed out, the dropped faults left their pages writeable
+
+Parameters:
+
+	Monitor - The started write monitor
+
+Return Value:
+
+	None
+
+--*/
+static void TrapDrainHandler(WRITE_MONITOR* Monitor)
+{
+	pollfd Descriptors[2] = { { Monitor->FaultDescriptor, POLLIN, 0 }, { Monitor->StopDescriptor, POLLIN, 0 } };
+
+	for (;;)
+	{
+		if (poll(Descriptors, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+
+		if (Descriptors[1].revents)
+		{
+			break;
+		}
+
+		unsigned long long Wakes;
+		if (read(Monitor->FaultDescriptor, &Wakes, sizeof(Wakes)) < 0 && errno != EAGAIN && errno != EINTR)
+		{
+			break;
+		}
+
+		{
+			std::lock_guard<std::mutex> Guard(Monitor->Lock);
+
+			size_t Page;
+			long long Time;
+			while (TrapRingPop(Page, Time))
+			{
+				std::chrono::steady_clock::time_point FaultTime{ std::chrono::nanoseconds(Time) };
+				Monitor->Pending.push_back({ reinterpret_cast<PVOID>(Page), FaultTime });
+			}
+
+			if (TrapRingOverflow.exchange(false, std::memory_order_acquire))
+			{
+				std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+				for (size_t Region = 0; Region < Monitor->Bases.size(); Region++)
+				{
+					for (SIZE_T Offset = 0; Offset < Monitor->Sizes[Region]; Offset += Monitor->PageSize)
+					{
+						Monitor->Pending.push_back({ static_cast<BYTE*>(Monitor->Bases[Region]) + Offset, Now });
+					}
+				}
+			}
+		}
+
+		Monitor->Signal.notify_one();
+	}
+}
+
+/*++
+
+Routine Description:
+
+	Installs the SIGSEGV handler and revokes write access from every region
+	Every region must be writeable, a write to a page the process could not write anyway is not the engine's to grant,
+	so a read-only region (the default registration) cannot be observed and the engine does not start
+	Register the writeable regions with ScanWriteableRegions (page-scanner.h) to use it
+
+Return Value:
+
+	DWORD - 0, ERROR_NOT_SUPPORTED, EBUSY when another trap monitor is started, or errno
+
+--*/
+static DWORD StartTrap(WRITE_MONITOR& Monitor)
+{
+	for (DWORD Protect : Monitor.Protections)
+	{
+		if (!(TrapProtection(Protect) & PROT_WRITE))
+		{
+			return ERROR_NOT_SUPPORTED;
+		}
+	}
+
+	WRITE_MONITOR* Expected = NULL;
+	if (!TrapMonitor.compare_exchange_strong(Expected, &Monitor))
+	{
+		return EBUSY;
+	}
+
+	for (size_t Slot = 0; Slot < WRITE_TRAP_RING_SIZE; Slot++)
+	{
+		TrapRing[Slot].Sequence.store(Slot, std::memory_order_relaxed);
+	}
+	TrapRingTail.store(0, std::memory_order_relaxed);
+	TrapRingHead = 0;
+	TrapRingOverflow.store(false, std::memory_order_relaxed);
+
+	Monitor.FaultDescriptor = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	Monitor.StopDescriptor = eventfd(0, EFD_CLOEXEC);
+	if (Monitor.FaultDescriptor < 0 || Monitor.StopDescriptor < 0)
+	{
+		DWORD StatusCode = errno;
+		StopWriteMonitor(Monitor);
+		return StatusCode;
+	}
+
+	Monitor.Handler = std::thread(TrapDrainHandler, &Monitor);
+
+	struct sigaction Action = {};
+	Action.sa_sigaction = TrapHandler;
+	Action.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&Action.sa_mask);
+	if (sigaction(SIGSEGV, &Action, &TrapPreviousAction) < 0)
+	{
+		DWORD StatusCode = errno;
+		StopWriteMonitor(Monitor);
+		return StatusCode;
+	}
+	TrapInstalled = true;
+
+	for (size_t Region = 0; Region < Monitor.Bases.size(); Region++)
+	{
+		if (mprotect(Monitor.Bases[Region], Monitor.Sizes[Region], TrapProtection(Monitor.Protections[Region]) & ~PROT_WRITE) < 0)
+		{
+			DWORD StatusCode = errno;
+			StopWriteMonitor(Monitor);
+			return StatusCode;
+		}
+	}
+	return 0;
+}
+
+/*++
+
+Routine Description:
+
+	Restores the protection of every region, then the previous SIGSEGV handler, so no fault reaches the trap afterwards
+
+--*/
+static void StopTrap(WRITE_MONITOR& Monitor)
+{
+	if (TrapMonitor.load(std::memory_order_acquire) != &Monitor)
+	{
+		return;
+	}
+
+	for (size_t Region = 0; Region < Monitor.Bases.size(); Region++)
+	{
+		mprotect(Monitor.Bases[Region], Monitor.Sizes[Region], TrapProtection(Monitor.Protections[Region]));
+	}
+
+	if (TrapInstalled)
+	{
+		sigaction(SIGSEGV, &TrapPreviousAction, NULL);
+		TrapInstalled = false;
+	}
+	TrapMonitor.store(NULL, std::memory_order_release);
+}
+#endif
+
+/*++
+
+Routine Description:
+
+	Write protects the monitored regions and starts the handler thread of the engine
+
+Parameters:
+
+	Monitor - The monitor to start, must not already be started
+	Engine - The write interception engine
+	Bases - The base addresses of the regions, page aligned, in ascending order
+	Sizes - The sizes of the regions
+	Protections - The PAGE_* protections of the regions
+
+Return Value:
+
+	DWORD - 0, ERROR_NOT_SUPPORTED when the engine is not available on this platform/kernel or for these regions, or errno
+
+--*/
+DWORD StartWriteMonitor(WRITE_MONITOR& Monitor, WRITE_MONITOR_ENGINE Engine, const std::vector<PVOID>& Bases, const std::vector<SIZE_T>& Sizes,
+	const std::vector<DWORD>& Protections)
+{
+	Monitor.Engine = Engine;
+	Monitor.Bases = Bases;
+	Monitor.Sizes = Sizes;
+	Monitor.Protections = Protections;
+	Monitor.FaultDescriptor = -1;
+	Monitor.StopDescriptor = -1;
+	Monitor.Stopping = false;
+	Monitor.Pending.clear();
+
+#if defined(__linux__)
+	Monitor.PageSize = sysconf(_SC_PAGESIZE);
+
+	switch (Engine)
+	{
+	case WriteMonitorUserfaultfd:
+		return StartUserfaultfd(Monitor, Monitor.Bases, Monitor.Sizes);
+	case WriteMonitorTrap:
+		return StartTrap(Monitor);
+	}
+#endif
+	return ERROR_NOT_SUPPORTED;
+}
+
+/*++
+
+Routine Description:
+
+	Blocks until at least one write fault is at least Settle old, then takes every fault that is
+	Settling gives the write that faulted time to land before its page is diffed (it is diffed lazily, not in the handler)
+
+Parameters:
+
+	Monitor - The started write monitor
+	Settle - How long after a fault its page is handed out
+	Faults - Receives the faults, in the order they occurred
+
+Return Value:
+
+	bool - false once the monitor is stopping
+
+--*/
+bool WaitWriteFaults(WRITE_MONITOR& Monitor, std::chrono::milliseconds Settle, std::vector<WRITE_FAULT>& Faults)
+{
+	std::unique_lock<std::mutex> Guard(Monitor.Lock);
+	for (;;)
+	{
+		Monitor.Signal.wait(Guard, [&] { return Monitor.Stopping || !Monitor.Pending.empty(); });
+		if (Monitor.Stopping)
+		{
+			return false;
+		}
+
+		std::chrono::steady_clock::time_point Ready = Monitor.Pending.front().Time + Settle;
+		if (std::chrono::steady_clock::now() >= Ready)
+		{
+			break;
+		}
+		Monitor.Signal.wait_until(Guard, Ready, [&] { return Monitor.Stopping; });
+	}
+
+	std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+	size_t Taken = 0;
+	while (Taken < Monitor.Pending.size() && Monitor.Pending[Taken].Time + Settle <= Now)
+	{
+		Taken++;
+	}
+
+	Faults.assign(Monitor.Pending.begin(), Monitor.Pending.begin() + Taken);
+	Monitor.Pending.erase(Monitor.Pending.begin(), Monitor.Pending.begin() + Taken);
+	return true;
+}
+
+/*++
+
+Routine Description:
+
+	Write protects the pages of a batch of faults again, one call per run of adjacent pages
+	Must be done before the pages are diffed, so a write racing the diff faults again
+
+Parameters:
+
+	Monitor - The started write monitor
+	Faults - The faults taken by WaitWriteFaults, a page may appear more than once
+
+Return Value:
+
+	DWORD - 0 or the errno of the last run that failed
+
+--*/
+DWORD RearmWritePages(WRITE_MONITOR& Monitor, const std::vector<WRITE_FAULT>& Faults)
+{
+#if defined(__linux__)
+	Monitor.Rearm.clear();
+	for (const WRITE_FAULT& Fault : Faults)
+	{
+		Monitor.Rearm.push_back(Fault.Page);
+	}
+	std::sort(Monitor.Rearm.begin(), Monitor.Rearm.end());
+	Monitor.Rearm.erase(std::unique(Monitor.Rearm.begin(), Monitor.Rearm.end()), Monitor.Rearm.end());
+
+	DWORD StatusCode = 0;
+	for (size_t First = 0; First < Monitor.Rearm.size();)
+	{
+		size_t Region = FindMonitorRegion(&Monitor, reinterpret_cast<size_t>(Monitor.Rearm[First]));
+		size_t Last = First + 1;
+		if (Region < Monitor.Bases.size())
+		{
+			BYTE* RegionEnd = static_cast<BYTE*>(Monitor.Bases[Region]) + Monitor.Sizes[Region];
+			while (Last < Monitor.Rearm.size() && Monitor.Rearm[Last] == static_cast<BYTE*>(Monitor.Rearm[Last - 1]) + Monitor.PageSize &&
+				Monitor.Rearm[Last] < RegionEnd)
+			{
+				Last++;
+			}
+
+			SIZE_T Length = (Last - First) * Monitor.PageSize;
+			DWORD RunStatus = 0;
+			if (Monitor.Engine == WriteMonitorUserfaultfd)
+			{
+				RunStatus = WriteProtectRange(Monitor.FaultDescriptor, Monitor.Rearm[First], Length, true);
+			}
+			else if (mprotect(Monitor.Rearm[First], Length, TrapProtection(Monitor.Protections[Region]) & ~PROT_WRITE) < 0)
+			{
+				RunStatus = errno;
+			}
+
+			if (RunStatus)
+			{
+				StatusCode = RunStatus;
+			}
+		}
+		First = Last;
+	}
+	return StatusCode;
+#else
+	return ERROR_NOT_SUPPORTED;
+#endif
+}
+
+// hands the page of a fault out again, Settle after now, for a fault that could not be handled yet
+void DeferWriteFault(WRITE_MONITOR& Monitor, const WRITE_FAULT& Fault)
+{
+	{
+		std::lock_guard<std::mutex> Guard(Monitor.Lock);
+		Monitor.Pending.push_back({ Fault.Page, std::chrono::steady_clock::now() });
+	}
+	Monitor.Signal.notify_all();
+}
+
+void StopWriteMonitor(WRITE_MONITOR& Monitor)
+{
+	{
+		std::lock_guard<std::mutex> Guard(Monitor.Lock);
+		Monitor.Stopping = true;
+	}
+	Monitor.Signal.notify_all();
+
+#if defined(__linux__)
+	if (Monitor.Engine == WriteMonitorTrap)
+	{
+		StopTrap(Monitor);
+	}
+
+	if (Monitor.StopDescriptor >= 0)
+	{
+		unsigned long long Stop = 1;
+		ssize_t Written = write(Monitor.StopDescriptor, &Stop, sizeof(Stop));
+		(void)Written;
+	}
+
+	if (Monitor.Handler.joinable())
+	{
+		Monitor.Handler.join();
+	}
+
+	if (Monitor.FaultDescriptor >= 0)
+	{
+		close(Monitor.FaultDescriptor);
+	}
+	if (Monitor.StopDescriptor >= 0)
+	{
+		close(Monitor.StopDescriptor);
+	}
+	Monitor.FaultDescriptor = -1;
+	Monitor.StopDescriptor = -1;
+#endif
+}
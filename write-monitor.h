@@ -0,0 +1,80 @@
+/*
+	MIT License
+
+	Copyright (c) 2020 Jason Johnson
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "platform.h"
+
+//
+// Write Monitor
+// Event driven alternative to sweeping: the monitored pages are write protected, and a write to one of them is
+// reported by a handler thread with the page and the moment of the write. The writer only resumes after the page
+// was recorded, so the page table snapshot (kept equal to the page since it was last re-armed) is its exact pre-image
+// Reported pages stay writeable until the consumer re-arms them in a batch, before diffing them
+//
+// Userfaultfd - userfaultfd write protect faults, the kernel only supports anonymous, shmem and hugetlb memory
+// Trap - mprotect revokes write, a SIGSEGV handler records the fault and restores write, only for regions that are writeable
+//   (the ScanWriteableRegions registration, page-scanner.h)
+//
+
+typedef enum _WRITE_MONITOR_ENGINE
+{
+	WriteMonitorUserfaultfd,
+	WriteMonitorTrap
+} WRITE_MONITOR_ENGINE;
+
+typedef struct _WRITE_FAULT
+{
+	PVOID Page;
+	std::chrono::steady_clock::time_point Time;
+} WRITE_FAULT;
+
+typedef struct _WRITE_MONITOR
+{
+	WRITE_MONITOR_ENGINE Engine;
+	SIZE_T PageSize;
+	std::vector<PVOID> Bases;
+	std::vector<SIZE_T> Sizes;
+	std::vector<DWORD> Protections;
+	int FaultDescriptor;
+	int StopDescriptor;
+	std::thread Handler;
+	std::mutex Lock;
+	std::condition_variable Signal;
+	std::vector<WRITE_FAULT> Pending;
+	std::vector<PVOID> Rearm;
+	bool Stopping;
+} WRITE_MONITOR;
+
+DWORD StartWriteMonitor(WRITE_MONITOR& Monitor, WRITE_MONITOR_ENGINE Engine, const std::vector<PVOID>& Bases, const std::vector<SIZE_T>& Sizes,
+	const std::vector<DWORD>& Protections);
+bool WaitWriteFaults(WRITE_MONITOR& Monitor, std::chrono::milliseconds Settle, std::vector<WRITE_FAULT>& Faults);
+DWORD RearmWritePages(WRITE_MONITOR& Monitor, const std::vector<WRITE_FAULT>& Faults);
+void DeferWriteFault(WRITE_MONITOR& Monitor, const WRITE_FAULT& Fault);
+void StopWriteMonitor(WRITE_MONITOR& Monitor);